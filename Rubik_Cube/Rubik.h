@@ -1,11 +1,11 @@
 #include <vector>
 #include <queue>
 #include <map>
-#include <fstream>
 
 #include "shader.hpp"
 #include "Cube.h"
-#include "solver.h"
+#include "solve_worker.h"
+#include "move_tracker.h"
 
 std::map<std::string, char> codes = {
 	{ "red",    'R' },
@@ -29,10 +29,35 @@ private:
 	rotation_type rotation_t;
 	float rotation_angle;
 	rotation_axis current_axis;
-	std::queue<std::string> solution;
+	// quarter turns still to play
+	std::queue<solver::Move> solution;
 	bool is_solving = false;
 	bool is_saved = false;
+	// solves off the render thread; apply_solution picks up its results
+	solver::solve_worker solve_worker;
+	// the turns made by hand since the last solution, to undo instead of
+	// searching again
+	solver::move_tracker tracker;
+	// the cube last sent to solve_worker, and the number it came back with;
+	// results for earlier cubes are dropped
+	solver::CubeState requested;
+	std::uint64_t requested_id = 0;
+
+	void queue_moves(const solver::MoveSequence& face_turns);
+	static solver::Move turn_of(rotation_type rt, bool is_clockwise);
 public:
+	// thistlethwaite suits hosts that cannot spare the two-phase tables;
+	// cfop plays a solution in stages a viewer can follow
+	solver::engine solve_engine = solver::engine::two_phase;
+	// the window waits this long for a solve; shorter solutions found
+	// within it replace longer ones
+	std::chrono::milliseconds solve_budget{ 50 };
+	// also write the cube to data.txt and the moves to result.txt, for debugging
+	bool export_files = false;
+	// a cube turned by hand since the last solution is solved by undoing
+	// the turns and playing that solution, if the two come to at most this
+	// many moves; otherwise it goes to the solver
+	std::size_t resolve_length = 22;
 	Cube matrix[3][3][3];
 
 	Rubik();
@@ -41,6 +66,7 @@ public:
 	void move_plane(float angle, rotation_axis axis);
 	void rotate_plane(std::vector<Cube*> pointers, bool is_clockwise);
 	void rotate(rotation_type rt, bool is_clockwise);
+	solver::CubeState cube_state();
 	void save_data();
 	void apply_solution();
 	void solve();
@@ -180,37 +206,56 @@ void Rubik::prepare_VB0_VAO()
 
 void Rubik::apply_solution()
 {
+	// read before draining, so an idle worker has nothing left in flight
+	bool waiting = solve_worker.busy();
+	solver::solve_worker::result result;
+	while (solve_worker.results().try_pop(result))
+	{
+		if (result.id != requested_id)
+			continue;
+		tracker.reset(requested, result.moves);
+		queue_moves(result.moves);
+	}
+	if (solution.empty())
+	{
+		if (!waiting)
+		{
+			is_solving = false;
+			// solved now, so hand turns from here on are all there is to undo;
+			// a cube left unsolved (nothing saved, an impossible cube, turns
+			// made during playback) has to go to the solver next time
+			solver::CubeState state = cube_state();
+			if (state.is_solved())
+				tracker.reset(state, solver::MoveSequence());
+			else
+				tracker.forget();
+		}
+		return;
+	}
+
 	double current_time = glfwGetTime();
 	if ((current_time - last_time_rubik) > 2.5 / PPS)
 	{
 		std::cout << "Movimientos restantes: " << solution.size() << "\n";
-		std::string word = solution.front();
-		std::cout <<  "Movimiento: "<< word << "\n";
+		solver::Move move = solution.front();
+		std::cout <<  "Movimiento: "<< solver::move_name(move) << "\n";
 		solution.pop();
-		if (word == "R")
-			rotate(rotation_type::RIGHT, false);
-		else if (word == "L")
-			rotate(rotation_type::LEFT, true);
-		else if (word == "U")
-			rotate(rotation_type::TOP, false);
-		else if (word == "D")
-			rotate(rotation_type::BOTTOM, true);
-		else if (word == "F")
-			rotate(rotation_type::FRONT, false);
-		else if (word == "B")
-			rotate(rotation_type::BACK, true);
-		else if (word == "R'")
-			rotate(rotation_type::RIGHT, true);
-		else if (word == "L'")
-			rotate(rotation_type::LEFT, false);
-		else if (word == "U'")
-			rotate(rotation_type::TOP, true);
-		else if (word == "D'")
-			rotate(rotation_type::BOTTOM, false);
-		else if (word == "F'")
-			rotate(rotation_type::FRONT, true);
-		else if (word == "B'")
-			rotate(rotation_type::BACK, false);
+		// rotate() looks at every axis from one side, so a clockwise U, R or
+		// F turn is is_clockwise false and a clockwise D, L or B turn is true;
+		// the slices turn as D (E), L (M) and F (S)
+		bool prime = solver::move_power(move) == 3;
+		switch (solver::move_face(move))
+		{
+		case 0: rotate(rotation_type::TOP, prime); break;
+		case 1: rotate(rotation_type::RIGHT, prime); break;
+		case 2: rotate(rotation_type::FRONT, prime); break;
+		case 3: rotate(rotation_type::BOTTOM, !prime); break;
+		case 4: rotate(rotation_type::LEFT, !prime); break;
+		case 5: rotate(rotation_type::BACK, !prime); break;
+		case 6: rotate(rotation_type::CENTER_Y, !prime); break;
+		case 7: rotate(rotation_type::CENTER_X, !prime); break;
+		case 8: rotate(rotation_type::CENTER_Z, prime); break;
+		}
 	}
 }
 
@@ -245,11 +290,8 @@ void Rubik::move_plane(float angle, rotation_axis axis)
 
 void Rubik::draw(Shader &shader, glm::mat4 proj)
 {
-	if (solution.size() > 0)
+	if (is_solving)
 		apply_solution();
-		
-	else
-		is_solving = false;
 	if (remaining_degreees > 0.02f || remaining_degreees < -0.02f)
 		move_plane(rotation_angle, current_axis);
 	else
@@ -384,20 +426,24 @@ void Rubik::rotate(rotation_type rt, bool is_clockwise)
 		rotate_plane(pointers, is_clockwise);
 		current_plane = pointers;
 		last_time_button = current_time;
+		// a turn by hand, not one of a solution being played
+		if (!is_solving)
+		{
+			tracker.turned(turn_of(rt, is_clockwise));
+			is_saved = false;
+		}
 
 		// std::cout << to_string();
 	}
 }
 
 
-void Rubik::save_data()
+// The stickers face by face, row by row, in the order solver::CubeState
+// keeps them
+solver::CubeState Rubik::cube_state()
 {
-	if (is_saved)
-		return;
-	// create file result.txt
-	is_saved = true;
-	std::ofstream file;
-	file.open("data.txt", std::ios::trunc);
+	solver::CubeState state;
+	char* sticker = &state.face[0][0][0];
 
 	// WHITE
 	for (int k = 2; k >= 0; k--)
@@ -408,10 +454,9 @@ void Rubik::save_data()
 			for (int f = 0; f < 6; f++)
 			{
 				if (matrix[i][0][k].faces[f].color_name != "gray" && op::get_axis(matrix[i][0][k].faces[f]) == rotation_axis::Y)
-					file << codes[matrix[i][0][k].faces[f].color_name];
+					*sticker++ = codes[matrix[i][0][k].faces[f].color_name];
 			}
 		}
-		file << "\n";
 	}
 
 	// ORANGE
@@ -423,10 +468,9 @@ void Rubik::save_data()
 			for (int f = 0; f < 6; f++)
 			{
 				if (matrix[i][j][0].faces[f].color_name != "gray" && op::get_axis(matrix[i][j][0].faces[f]) == rotation_axis::Z)
-					file << codes[matrix[i][j][0].faces[f].color_name];
+					*sticker++ = codes[matrix[i][j][0].faces[f].color_name];
 			}
 		}
-		file << "\n";
 	}
 	
 	// GREEN
@@ -438,10 +482,9 @@ void Rubik::save_data()
 			for (int f = 0; f < 6; f++)
 			{
 				if (matrix[0][j][k].faces[f].color_name != "gray" && op::get_axis(matrix[0][j][k].faces[f]) == rotation_axis::X)
-					file << codes[matrix[0][j][k].faces[f].color_name];
+					*sticker++ = codes[matrix[0][j][k].faces[f].color_name];
 			}
 		}
-		file << "\n";
 	}
 
 	// RED
@@ -453,10 +496,9 @@ void Rubik::save_data()
 			for (int f = 0; f < 6; f++)
 			{
 				if (matrix[i][j][2].faces[f].color_name != "gray" && op::get_axis(matrix[i][j][2].faces[f]) == rotation_axis::Z)
-					file << codes[matrix[i][j][2].faces[f].color_name];
+					*sticker++ = codes[matrix[i][j][2].faces[f].color_name];
 			}
 		}
-		file << "\n";
 	}
 
 	// BLUE
@@ -468,11 +510,9 @@ void Rubik::save_data()
 			for (int f = 0; f < 6; f++)
 			{
 				if (matrix[2][j][k].faces[f].color_name != "gray" && op::get_axis(matrix[2][j][k].faces[f]) == rotation_axis::X)
-					file << codes[matrix[2][j][k].faces[f].color_name];
+					*sticker++ = codes[matrix[2][j][k].faces[f].color_name];
 			}
 		}
-			
-		file << "\n";
 	}
 	
 	// YELLOW
@@ -484,15 +524,46 @@ void Rubik::save_data()
 			for (int f = 0; f < 6; f++)
 			{
 				if (matrix[i][2][k].faces[f].color_name != "gray" && op::get_axis(matrix[i][2][k].faces[f]) == rotation_axis::Y)
-					file << codes[matrix[i][2][k].faces[f].color_name];
+					*sticker++ = codes[matrix[i][2][k].faces[f].color_name];
 			}
 		}
-		file << "\n";
 	}
 
-	file.close();
+	return state;
+}
+
 
-	solver::solve();
+void Rubik::save_data()
+{
+	if (is_saved)
+		return;
+	is_saved = true;
+	// whatever was left of an earlier solution is for another cube, and so
+	// is anything still coming from the worker
+	solution = std::queue<solver::Move>();
+	requested_id = 0;
+	solver::CubeState state = cube_state();
+	// an impossible cube never reaches the solver
+	solver::cube_error error = solver::check_cube(state);
+	if (error != solver::cube_error::none)
+	{
+		std::cout << "Cubo imposible: " << solver::error_name(error) << "\n";
+		return;
+	}
+	if (export_files)
+		solver::write_data(state);
+	solver::MoveSequence moves;
+	if (tracker.solve(state, resolve_length, moves))
+	{
+		std::cout << "Deshaciendo " << moves.size() << " movimientos\n";
+		if (export_files)
+			solver::write_result(moves);
+		tracker.reset(state, moves);
+		queue_moves(moves);
+		return;
+	}
+	requested = state;
+	requested_id = solve_worker.request(state, solve_engine, solve_budget, export_files);
 }
 
 
@@ -502,47 +573,46 @@ void Rubik::solve()
 		return;
 	is_solving = true;
 
-    // read from result.txt
-    std::ifstream file("result.txt");
-    // read word by word separated by spaces
-    std::string word;
-    while (file >> word)
-    {
-		//std::cout << "--" << word << "--";
-		
-		if (word == "R2")
-		{
-			solution.push("R");
-			solution.push("R");
-		}
-		else if (word == "L2")
-		{
-			solution.push("L");
-			solution.push("L");
-		}
-		else if (word == "U2")
-		{
-			solution.push("U");
-			solution.push("U");
-		}
-		else if (word == "D2")
-		{
-			solution.push("D");
-			solution.push("D");
-		}
-		else if (word == "F2")
-		{
-			solution.push("F");
-			solution.push("F");
-		}
-		else if (word == "B2")
+	// the moves come from solve_worker as soon as it is done
+}
+
+
+// The turn rotate() makes, the inverse of the mapping in apply_solution
+solver::Move Rubik::turn_of(rotation_type rt, bool is_clockwise)
+{
+	int face = 0;
+	bool prime = is_clockwise;
+	switch (rt)
+	{
+	case rotation_type::TOP: face = 0; break;
+	case rotation_type::RIGHT: face = 1; break;
+	case rotation_type::FRONT: face = 2; break;
+	case rotation_type::BOTTOM: face = 3; prime = !is_clockwise; break;
+	case rotation_type::LEFT: face = 4; prime = !is_clockwise; break;
+	case rotation_type::BACK: face = 5; prime = !is_clockwise; break;
+	case rotation_type::CENTER_Y: face = 6; prime = !is_clockwise; break;
+	case rotation_type::CENTER_X: face = 7; prime = !is_clockwise; break;
+	case rotation_type::CENTER_Z: face = 8; break;
+	}
+	return solver::make_move(face, prime ? 3 : 1);
+}
+
+
+// Turns one at a time, a half turn as two quarter turns; opposite faces
+// turned against each other play as one slice turn
+void Rubik::queue_moves(const solver::MoveSequence& face_turns)
+{
+	solver::MoveSequence moves = solver::slice_turns(face_turns);
+	for (size_t i = 0; i < moves.size(); i++)
+	{
+		if (solver::move_power(moves[i]) == 2)
 		{
-			solution.push("B");
-			solution.push("B");
+			solution.push(solver::make_move(solver::move_face(moves[i]), 1));
+			solution.push(solver::make_move(solver::move_face(moves[i]), 1));
 		}
 		else
-			solution.push(word);
-    }
+			solution.push(moves[i]);
+	}
 }
 
 
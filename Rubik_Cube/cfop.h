@@ -0,0 +1,388 @@
+#ifndef CFOP_H
+#define CFOP_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "coordinate.h"
+#include "cubie.h"
+#include "table_cache.h"
+
+// The method people solve by, for solutions a viewer can follow stage by
+// stage:
+//   cross  the four D edges, walked straight down a distance table
+//   F2L    the four D corner and middle edge pairs, each the shortest
+//          insertion that keeps the cross and the pairs already in
+//   OLL    the U layer turned face up
+//   PLL    the U layer pieces put in place
+// The last layer takes no search and no branching: the twists and flips of
+// the U layer index a table of every OLL case, the order of its pieces one
+// of every PLL case, and each entry holds the moves for that case, U turns
+// before and after included. Solutions run about 55 moves.
+namespace solver
+{
+    namespace cfop
+    {
+        const int N_CROSS = 11880 * 16;     // places and flips of the four D edges
+        const int N_PAIR = 24 * 24 * 528;   // a slot's corner, its edge and the two cross edges beside it
+        const int N_OLL = 81 * 16;          // twists and flips of the U layer
+        const int N_PLL = 24 * 24;          // orders of the U corners and the U edges
+        const int MAX_CASE_MOVES = 17;
+        const int MAX_PAIR_MOVES = 14;
+
+        // One algorithm for each of the 57 OLL and 21 PLL cases, shortest
+        // first, as found by search when these tables were made: the OLL
+        // ones the shortest in U, R, F and L turns, the PLL ones the
+        // shortest in any. The cases they are filed under take care of the
+        // U turns around them.
+        const char* const oll_algorithms[57] = {
+            "F R U R' U' F'", "F U R U' R' F'", "R' U' F' U F R", "L F R' F R F2 L'",
+            "L F2 R' F' R F' L'", "L U L' U L U2 L'", "R U2 R' U' R U' R'", "R' F' L F' L' F2 R",
+            "R' F2 L F L' F R", "F R F' L F R' F' L'", "F' L F R' F' L' F R", "L U L F' L' F U' L'",
+            "R U R' U' R' F R F'", "R' F R F' U' F' U F", "F R' F' U' F U R U' F'", "F R' F2 R U2 R U2 R' F",
+            "F2 R2 F L2 F' R2 F L2 F", "R U2 R2 F R F' R U2 R'", "R U2 R2 U' R2 U' R2 U2 R", "R' F R2 F' U2 F' U2 F R'",
+            "R' L U' F' U F R U L'", "R' U L F U F' U' R L'", "R' U' F U R U' R' F' R", "R2 F2 L F L' F2 R F' R",
+            "F R F' L F R2 F R F2 L'", "F R U R' U' R U R' U' F'", "F R' F' R U2 F2 L F L' F", "F U F' R' F R U' R' F' R",
+            "F U R U' R' U R U' R' F'", "F' L F L' U2 F2 R' F' R F'", "F' L' F R F' U' L U F R'", "F' U' F U L F R' F' R L'",
+            "L U F U2 F' U' F U F' L'", "R U R' U' R' L F R F' L'", "R U R2 F' U' F U R2 U2 R'", "R' F' R L' U' L U R' F R",
+            "R' F' U' F U F' U' F U R", "R' F' U' F U' R U R' U R", "R' U' F' U L' F R F' L F", "R' U' F' U2 F U F' U' F R",
+            "R' U' R F R' F' U F R F'", "R' U2 L' F' L U2 L' F R L", "F U R' F R F2 U' F' L F L'", "F' L2 F2 U' L U' L' U2 F2 L2 F",
+            "L F U F2 L F L2 U L U2 L'", "R U2 R' U' R U R' U' R U' R'", "R U2 R2 U' R U' R' U2 F R F'", "R' F' L' F R2 F' U' L U F R'",
+            "R' F' L' U2 L U2 L' U2 L F R", "R' F2 R2 U2 R' F' R U2 R2 F2 R", "R' L F L' U2 L F R' F R2 L'", "R' L F' U' R' F' R F U R L'",
+            "R' L2 F L' F L F2 L' F R L'", "R' U' F' L U F' U' L' U F2 R", "R' U2 F R U R' U' F2 U2 F R", "R' U2 L F' L' U2 L F L' U2 R",
+            "R L F U2 R2 U2 R2 U2 R2 F' R' L'"
+        };
+
+        const char* const pll_algorithms[21] = {
+            "B2 R2 L2 F2 D F2 R2 L2 B2", "F2 R2 F L F' R2 F L' F", "L' B L' F2 L B' L' F2 L2",
+            "L2 U F' B L2 F B' U L2", "L2 U' F' B L2 F B' U' L2", "B2 D B D' B R2 F' U F R2",
+            "B2 D' B' D B' L2 F U' F' L2", "B2 U B2 D' R2 F2 U' F2 D R2", "B U B' R2 D' F U' F' U F' D R2",
+            "B2 D F2 D R2 F D B' D2 F D' B'", "B2 R2 L2 U L2 U' L2 D L2 D' R2 B2", "B2 U F2 R2 U' L2 B2 R2 D' L2 U' B2",
+            "R' D' L D2 R' D L B2 D L2 D R2", "B' U' B R2 B' U B U R2 U' R2 U' R2", "B2 R2 F' B2 U F' L2 B D' F L2 F B'",
+            "B2 R2 U B U B' U' B' U' R2 B' U B'", "L' U L2 B2 D R' F2 R D' B2 L2 U' L", "L' U L2 F2 U L' F2 L U' F2 L2 U' L",
+            "R' U R' B2 U' R' U' R' U R U B2 R2", "B' U F' U B U2 R B L2 B' R' L2 U F", "B2 U R2 U2 R2 B2 U R2 U R2 U2 B2 U' B2"
+        };
+
+        // The moves that finish one stage of the last layer from a case;
+        // length 255 for a case no cube with its first two layers done has
+        struct last_layer_case
+        {
+            std::uint8_t length;
+            Move moves[MAX_CASE_MOVES];
+        };
+
+        // Where each stage ends in a solution
+        struct stages
+        {
+            size_t cross, f2l, oll, pll;
+        };
+
+        // Places of a set of four edges (first, first + 1, ...) with their
+        // flips
+        inline int edge_set(const CubieCube& c, int first)
+        {
+            int place[4];
+            for (int i = 0; i < 12; i++)
+                if (c.ep[i] >= first && c.ep[i] < first + 4)
+                    place[c.ep[i] - first] = i;
+            int flips = 0;
+            for (int k = 0; k < 4; k++)
+                flips = flips * 2 + c.eo[place[k]];
+            return coordinate::rank<12, 4>(place) * 16 + flips;
+        }
+
+        inline int cross_index(const CubieCube& c) { return edge_set(c, DR); }
+
+        // Slot s holds corner DFR + s and edge FR + s, next to the cross
+        // edges DR + s and DR + (s + 1) % 4
+        inline int pair_index(const CubieCube& c, int s)
+        {
+            int corner = 0, edge = 0, beside[2] = { 0, 0 };
+            for (int i = 0; i < 8; i++)
+                if (c.cp[i] == DFR + s)
+                    corner = i;
+            for (int i = 0; i < 12; i++)
+            {
+                if (c.ep[i] == FR + s)
+                    edge = i;
+                else if (c.ep[i] == DR + s)
+                    beside[0] = i;
+                else if (c.ep[i] == DR + (s + 1) % 4)
+                    beside[1] = i;
+            }
+            int pair = (corner * 3 + c.co[corner]) * 24 + edge * 2 + c.eo[edge];
+            return (pair * 132 + coordinate::rank<12, 2>(beside)) * 4 + c.eo[beside[0]] * 2 + c.eo[beside[1]];
+        }
+
+        inline int oll_index(const CubieCube& c)
+        {
+            return c.co[URF] + c.co[UFL] * 3 + c.co[ULB] * 9 + c.co[UBR] * 27
+                + (c.eo[UR] + c.eo[UF] * 2 + c.eo[UL] * 4 + c.eo[UB] * 8) * 81;
+        }
+
+        // Only meaningful with the first two layers done
+        inline int pll_index(const CubieCube& c)
+        {
+            return coordinate::rank<4>(c.cp) * 24 + coordinate::rank<4>(c.ep);
+        }
+
+        struct tables
+        {
+            std::uint8_t cross[N_CROSS];    // moves to the cross
+            std::uint8_t pair[4][N_PAIR];   // moves to slot s's pair and the cross edges beside it
+            last_layer_case oll[N_OLL];
+            last_layer_case pll[N_PLL];
+
+            void build()
+            {
+                distances(cross, N_CROSS, [](const CubieCube& c) { return cross_index(c); });
+                for (int s = 0; s < 4; s++)
+                    distances(pair[s], N_PAIR, [s](const CubieCube& c) { return pair_index(c, s); });
+
+                // every case an algorithm makes, from the U turn before it
+                // (and after it, for PLL), the shortest kept
+                for (int i = 0; i < N_OLL; i++)
+                    oll[i].length = 255;
+                oll[0].length = 0;
+                for (const char* text : oll_algorithms)
+                {
+                    MoveSequence algorithm;
+                    parse_moves(text, algorithm);
+                    for (int before = 0; before < 4; before++)
+                    {
+                        MoveSequence moves = u_turn(before);
+                        moves.insert(moves.end(), algorithm.begin(), algorithm.end());
+                        file(oll, oll_index(undone(moves)), simplify(moves));
+                    }
+                }
+
+                for (int i = 0; i < N_PLL; i++)
+                    pll[i].length = 255;
+                for (int after = 0; after < 4; after++)
+                    file(pll, pll_index(undone(u_turn(after))), u_turn(after));
+                for (const char* text : pll_algorithms)
+                {
+                    MoveSequence algorithm;
+                    parse_moves(text, algorithm);
+                    for (int before = 0; before < 4; before++)
+                    {
+                        for (int after = 0; after < 4; after++)
+                        {
+                            MoveSequence moves = u_turn(before);
+                            moves.insert(moves.end(), algorithm.begin(), algorithm.end());
+                            MoveSequence last = u_turn(after);
+                            moves.insert(moves.end(), last.begin(), last.end());
+                            file(pll, pll_index(undone(moves)), simplify(moves));
+                        }
+                    }
+                }
+            }
+
+            // Layout and contents of the cached table file
+            static const std::uint32_t VERSION = 1;
+
+            static const tables& get()
+            {
+                static const tables* instance = table_cache::load<tables>("cfop", VERSION, create);
+                return *instance;
+            }
+
+        private:
+            static const tables* create()
+            {
+                tables* t = new tables;
+                t->build();
+                return t;
+            }
+
+            // Breadth first from solved, over whole cubes; the index only
+            // sees the pieces it follows
+            template <typename Index>
+            static void distances(std::uint8_t* table, int size, Index index)
+            {
+                std::memset(table, 255, size_t(size));
+                std::vector<CubieCube> frontier(1, CubieCube::solved());
+                table[index(frontier[0])] = 0;
+                for (int d = 1; !frontier.empty(); d++)
+                {
+                    std::vector<CubieCube> next;
+                    for (const CubieCube& c : frontier)
+                    {
+                        for (int m = 0; m < MOVE_COUNT; m++)
+                        {
+                            CubieCube n = c;
+                            n.move(Move(m));
+                            int i = index(n);
+                            if (table[i] != 255)
+                                continue;
+                            table[i] = std::uint8_t(d);
+                            next.push_back(n);
+                        }
+                    }
+                    frontier.swap(next);
+                }
+            }
+
+            static MoveSequence u_turn(int quarter_turns)
+            {
+                return quarter_turns == 0 ? MoveSequence() : MoveSequence(1, make_move(0, quarter_turns));
+            }
+
+            // The cube the moves solve
+            static CubieCube undone(const MoveSequence& moves)
+            {
+                CubieCube c = CubieCube::solved();
+                for (size_t i = moves.size(); i-- > 0;)
+                    c.move(make_move(move_face(moves[i]), 4 - move_power(moves[i])));
+                return c;
+            }
+
+            static void file(last_layer_case* cases, int i, const MoveSequence& moves)
+            {
+                if (cases[i].length != 255 && cases[i].length <= moves.size())
+                    return;
+                cases[i].length = std::uint8_t(moves.size());
+                for (size_t k = 0; k < moves.size(); k++)
+                    cases[i].moves[k] = moves[k];
+            }
+        };
+
+        // The fewest moves that put one more pair in while keeping the
+        // cross and the pairs already in
+        class pair_search
+        {
+        public:
+            explicit pair_search(const tables& t) : t(t) {}
+
+            // The pairs in: bit s for slot s
+            int pairs_in(const CubieCube& c) const
+            {
+                int in = 0;
+                for (int s = 0; s < 4; s++)
+                    if (t.pair[s][pair_index(c, s)] == 0)
+                        in |= 1 << s;
+                return in;
+            }
+
+            bool run(const CubieCube& cube, MoveSequence& result)
+            {
+                in = pairs_in(cube);
+                for (int depth = 0; depth <= MAX_PAIR_MOVES; depth++)
+                {
+                    result.clear();
+                    if (dfs(cube, depth, -1, result))
+                        return true;
+                }
+                return false;
+            }
+
+        private:
+            const tables& t;
+            int in = 0;
+
+            // Moves at least to the goal: the cross and the pairs in must
+            // come back, and one more pair must get there
+            int bound(const CubieCube& c) const
+            {
+                int keep = t.cross[cross_index(c)], nearest = 255;
+                for (int s = 0; s < 4; s++)
+                {
+                    int d = t.pair[s][pair_index(c, s)];
+                    if (in >> s & 1)
+                        keep = d > keep ? d : keep;
+                    else
+                        nearest = d < nearest ? d : nearest;
+                }
+                return keep > nearest ? keep : nearest;
+            }
+
+            bool dfs(const CubieCube& c, int depth, int last_face, MoveSequence& path)
+            {
+                int b = bound(c);
+                if (b == 0)
+                    return true;
+                if (b > depth)
+                    return false;
+                for (int m = 0; m < MOVE_COUNT; m++)
+                {
+                    int face = move_face(Move(m));
+                    if (face == last_face || face == last_face - 3)
+                        continue;
+                    CubieCube n = c;
+                    n.move(Move(m));
+                    path.push_back(Move(m));
+                    if (dfs(n, depth - 1, face, path))
+                        return true;
+                    path.pop_back();
+                }
+                return false;
+            }
+        };
+
+        // Solves a cube stage by stage, the cross on D; each stage's moves
+        // are simplified on their own, so the stages stay apart
+        inline bool solve(const CubieCube& start, MoveSequence& result, stages* ends = nullptr)
+        {
+            const tables& t = tables::get();
+            CubieCube c = start;
+            result.clear();
+            auto play = [&](const MoveSequence& moves)
+            {
+                for (Move m : moves)
+                    c.move(m);
+                MoveSequence s = simplify(moves);
+                result.insert(result.end(), s.begin(), s.end());
+            };
+
+            MoveSequence moves;
+            for (CubieCube n = c; t.cross[cross_index(n)] > 0;)
+            {
+                int down = t.cross[cross_index(n)] - 1;
+                for (int m = 0; m < MOVE_COUNT; m++)
+                {
+                    CubieCube next = n;
+                    next.move(Move(m));
+                    if (t.cross[cross_index(next)] == down)
+                    {
+                        n = next;
+                        moves.push_back(Move(m));
+                        break;
+                    }
+                }
+            }
+            play(moves);
+            size_t cross_end = result.size();
+
+            pair_search pairs(t);
+            MoveSequence f2l;
+            for (CubieCube n = c; pairs.pairs_in(n) != 15;)
+            {
+                if (!pairs.run(n, moves))
+                    return false;
+                for (Move m : moves)
+                    n.move(m);
+                f2l.insert(f2l.end(), moves.begin(), moves.end());
+            }
+            play(f2l);
+            size_t f2l_end = result.size();
+
+            const last_layer_case& oll = t.oll[oll_index(c)];
+            if (oll.length == 255)
+                return false;
+            play(MoveSequence(oll.moves, oll.moves + oll.length));
+            size_t oll_end = result.size();
+
+            const last_layer_case& pll = t.pll[pll_index(c)];
+            if (pll.length == 255)
+                return false;
+            play(MoveSequence(pll.moves, pll.moves + pll.length));
+
+            if (ends)
+                *ends = stages{ cross_end, f2l_end, oll_end, result.size() };
+            return c == CubieCube::solved();
+        }
+    }
+}
+
+#endif
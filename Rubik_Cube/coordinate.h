@@ -0,0 +1,182 @@
+#ifndef COORDINATE_H
+#define COORDINATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+#include "facelet_move.h"
+
+// Dense coordinates of permutations: the lexicographic (Lehmer code) rank
+// of the first K entries of a permutation of 0..N-1, and back. A bit mask
+// of the values already seen turns each Lehmer digit into one population
+// count instead of a scan over the earlier entries, and picking the d-th
+// unused value back out into a table lookup, or one pdep where BMI2 is
+// there.
+namespace solver
+{
+    namespace coordinate
+    {
+        constexpr int factorial[13] = { 1, 1, 2, 6, 24, 120, 720, 5040, 40320, 362880, 3628800, 39916800, 479001600 };
+
+        // Set bits of every 12-bit mask
+        struct bit_counts
+        {
+            std::uint8_t count[1 << 12];
+
+            constexpr bit_counts() : count()
+            {
+                for (int i = 1; i < 1 << 12; i++)
+                    count[i] = std::uint8_t(count[i >> 1] + (i & 1));
+            }
+        };
+
+        inline constexpr bit_counts bit_count{};
+
+        // Position of the d-th set bit of every 6-bit mask, for d up to 7
+        struct bit_selects
+        {
+            std::uint8_t select[64][8];
+
+            constexpr bit_selects() : select()
+            {
+                for (int m = 0; m < 64; m++)
+                    for (int b = 0, d = 0; b < 6; b++)
+                        if (m >> b & 1)
+                            select[m][d++] = std::uint8_t(b);
+            }
+        };
+
+        inline constexpr bit_selects bit_select{};
+
+        // Number of ranks of the first K entries: N! / (N-K)!
+        template <int N, int K = N>
+        constexpr int count() { return factorial[N] / factorial[N - K]; }
+
+        // Digits of a rank, last first, unrolled so every division is by a
+        // constant
+        template <int N, int K, std::size_t... I>
+        inline void lehmer_digits(int r, int* d, std::index_sequence<I...>)
+        {
+            ((d[K - 1 - I] = r % (N - K + 1 + int(I)), r /= N - K + 1 + int(I)), ...);
+        }
+
+        template <int N, int K = N, typename T>
+        inline int rank_scalar(const T* p)
+        {
+            static_assert(K <= N && N <= 12, "masks are 12 bits wide");
+            unsigned used = 0;
+            int r = 0;
+            for (int i = 0; i < K; i++)
+            {
+                unsigned v = p[i];
+                r = r * (N - i) + int(v) - bit_count.count[used & ((1u << v) - 1)];
+                used |= 1u << v;
+            }
+            return r;
+        }
+
+        template <int N, int K = N, typename T>
+        inline void unrank_scalar(int r, T* p)
+        {
+            int d[K];
+            lehmer_digits<N, K>(r, d, std::make_index_sequence<K>());
+            // the d-th unused value from the low or the high six bits,
+            // picked without a branch on d
+            unsigned unused = (1u << N) - 1;
+            for (int i = 0; i < K; i++)
+            {
+                int low = bit_count.count[unused & 63];
+                int in_low = bit_select.select[unused & 63][d[i] & 7];
+                int in_high = 6 + bit_select.select[unused >> 6][(d[i] - low) & 7];
+                int v = d[i] < low ? in_low : in_high;
+                unused &= ~(1u << v);
+                p[i] = T(v);
+            }
+        }
+
+#ifdef RUBIK_X86
+        template <int N, int K = N, typename T>
+        RUBIK_TARGET("bmi,bmi2,popcnt") inline int rank_bmi2(const T* p)
+        {
+            static_assert(K <= N && N <= 12, "masks are 12 bits wide");
+            unsigned used = 0;
+            int r = 0;
+            for (int i = 0; i < K; i++)
+            {
+                unsigned v = p[i];
+                r = r * (N - i) + int(v) - _mm_popcnt_u32(_bzhi_u32(used, v));
+                used |= 1u << v;
+            }
+            return r;
+        }
+
+        template <int N, int K = N, typename T>
+        RUBIK_TARGET("bmi,bmi2,popcnt") inline void unrank_bmi2(int r, T* p)
+        {
+            int d[K];
+            lehmer_digits<N, K>(r, d, std::make_index_sequence<K>());
+            unsigned unused = (1u << N) - 1;
+            for (int i = 0; i < K; i++)
+            {
+                unsigned bit = _pdep_u32(1u << d[i], unused);
+                unused ^= bit;
+                p[i] = T(_tzcnt_u32(bit));
+            }
+        }
+
+        inline bool cpu_has_bmi2()
+        {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 1);
+            if ((info[2] >> 23 & 1) == 0)
+                return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] >> 8 & 1) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt");
+#endif
+        }
+#endif
+
+        // BMI2 when the processor has it, unless $RUBIK_RANK_KERNEL is
+        // scalar (pdep is microcoded and slow on AMD before Zen 3)
+        inline bool pick_bmi2()
+        {
+#ifdef RUBIK_X86
+            const char* name = std::getenv("RUBIK_RANK_KERNEL");
+            return (name == nullptr || std::string(name) != "scalar") && cpu_has_bmi2();
+#else
+            return false;
+#endif
+        }
+
+        inline const bool use_bmi2 = pick_bmi2();
+
+        template <int N, int K = N, typename T>
+        inline int rank(const T* p)
+        {
+#ifdef RUBIK_X86
+            if (use_bmi2)
+                return rank_bmi2<N, K>(p);
+#endif
+            return rank_scalar<N, K>(p);
+        }
+
+        template <int N, int K = N, typename T>
+        inline void unrank(int r, T* p)
+        {
+#ifdef RUBIK_X86
+            if (use_bmi2)
+                return unrank_bmi2<N, K>(r, p);
+#endif
+            unrank_scalar<N, K>(r, p);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef CUBE_BATCH_H
+#define CUBE_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "cube_state.h"
+#include "facelet_move.h"
+
+// Many cubes moved at once. Cubes are kept in blocks of 64 lanes, and
+// within a block facelet i of all 64 cubes sits side by side in one 64-byte
+// row, so one vector register holds a facelet of 32 (AVX2) or 64 (AVX-512)
+// cubes. Turning every cube the same way only moves 20 rows; turning each
+// cube its own way blends, for every move some lane wants, the 20 rows of
+// that move into the lanes that want it.
+namespace solver
+{
+    class cube_batch
+    {
+    public:
+        static constexpr size_t LANES = 64;
+
+        // A lane given this instead of a move stays as it is
+        static constexpr Move NO_MOVE = TURN_COUNT;
+
+        // Facelet i of the 64 cubes of a block; a block is 54 rows
+        struct alignas(64) row
+        {
+            std::uint8_t lane[LANES];
+        };
+
+        // Turns each cube of a block by its move, NO_MOVE or one of the 18
+        typedef void (*lane_kernel)(row* block, const std::uint8_t* moves);
+
+        // count solved cubes
+        explicit cube_batch(size_t count) : count(count), rows((count + LANES - 1) / LANES * 54)
+        {
+            CubeState solved = CubeState::solved();
+            for (size_t i = 0; i < count; i++)
+                set(i, solved);
+        }
+
+        size_t size() const { return count; }
+
+        void set(size_t cube, const CubeState& state)
+        {
+            row* block = &rows[cube / LANES * 54];
+            const char* facelets = &state.face[0][0][0];
+            for (int i = 0; i < 54; i++)
+                block[i].lane[cube % LANES] = std::uint8_t(facelets[i]);
+        }
+
+        CubeState get(size_t cube) const
+        {
+            const row* block = &rows[cube / LANES * 54];
+            CubeState state;
+            char* facelets = &state.face[0][0][0];
+            for (int i = 0; i < 54; i++)
+                facelets[i] = char(block[i].lane[cube % LANES]);
+            return state;
+        }
+
+        // The same move on every cube
+        void apply(Move m)
+        {
+            const facelet_turn& t = facelet_turns.move[m];
+            row moving[20];
+            for (size_t b = 0; b < rows.size(); b += 54)
+            {
+                for (int k = 0; k < 20; k++)
+                    moving[k] = rows[b + t.from[k]];
+                for (int k = 0; k < 20; k++)
+                    rows[b + t.to[k]] = moving[k];
+            }
+        }
+
+        void apply(const MoveSequence& moves)
+        {
+            for (size_t i = 0; i < moves.size(); i++)
+                apply(moves[i]);
+        }
+
+        // moves[i] on cube i, for as many cubes as there are moves
+        void apply(std::span<const Move> moves)
+        {
+            static const lane_kernel kernel = pick_lane_kernel();
+            apply(moves, kernel);
+        }
+
+        void apply(std::span<const Move> moves, lane_kernel kernel)
+        {
+            alignas(64) std::uint8_t block_moves[LANES];
+            for (size_t b = 0; b * LANES < count && b * LANES < moves.size(); b++)
+            {
+                for (size_t l = 0; l < LANES; l++)
+                {
+                    size_t i = b * LANES + l;
+                    block_moves[l] = std::uint8_t(i < count && i < moves.size() ? moves[i] : NO_MOVE);
+                }
+                kernel(&rows[b * 54], block_moves);
+            }
+        }
+
+        bool is_solved(size_t cube) const { return get(cube).is_solved(); }
+
+        // Cubes with every sticker the colour of its centre
+        size_t count_solved() const
+        {
+            size_t solved = 0;
+            for (size_t b = 0; b < rows.size(); b += 54)
+            {
+                std::uint8_t ok[LANES];
+                std::memset(ok, 1, LANES);
+                for (int f = 0; f < 6; f++)
+                    for (int i = 0; i < 9; i++)
+                        for (size_t l = 0; l < LANES; l++)
+                            ok[l] &= rows[b + f * 9 + i].lane[l] == rows[b + f * 9 + 4].lane[l];
+                for (size_t l = 0; l < LANES && b / 54 * LANES + l < count; l++)
+                    solved += ok[l];
+            }
+            return solved;
+        }
+
+        static void scalar_lanes(row* block, const std::uint8_t* moves)
+        {
+            for (size_t l = 0; l < LANES; l++)
+            {
+                if (moves[l] == NO_MOVE)
+                    continue;
+                const facelet_turn& t = facelet_turns.move[moves[l]];
+                std::uint8_t moving[20];
+                for (int k = 0; k < 20; k++)
+                    moving[k] = block[t.from[k]].lane[l];
+                for (int k = 0; k < 20; k++)
+                    block[t.to[k]].lane[l] = moving[k];
+            }
+        }
+
+#ifdef RUBIK_X86
+        RUBIK_TARGET("avx2") static void avx2_lanes(row* block, const std::uint8_t* moves)
+        {
+            row before[54];
+            std::memcpy(before, block, sizeof(before));
+            for (int half = 0; half < 2; half++)
+            {
+                __m256i wanted = _mm256_load_si256(reinterpret_cast<const __m256i*>(moves + half * 32));
+                for (int m = 0; m < MOVE_COUNT; m++)
+                {
+                    __m256i mask = _mm256_cmpeq_epi8(wanted, _mm256_set1_epi8(char(m)));
+                    if (_mm256_testz_si256(mask, mask))
+                        continue;
+                    const facelet_turn& t = facelet_turns.move[m];
+                    for (int k = 0; k < 20; k++)
+                    {
+                        __m256i* to = reinterpret_cast<__m256i*>(block[t.to[k]].lane + half * 32);
+                        __m256i from = _mm256_load_si256(reinterpret_cast<const __m256i*>(before[t.from[k]].lane + half * 32));
+                        _mm256_store_si256(to, _mm256_blendv_epi8(_mm256_load_si256(to), from, mask));
+                    }
+                }
+            }
+        }
+
+        RUBIK_TARGET("avx512f,avx512bw") static void avx512_lanes(row* block, const std::uint8_t* moves)
+        {
+            row before[54];
+            std::memcpy(before, block, sizeof(before));
+            __m512i wanted = _mm512_load_si512(moves);
+            for (int m = 0; m < MOVE_COUNT; m++)
+            {
+                __mmask64 mask = _mm512_cmpeq_epi8_mask(wanted, _mm512_set1_epi8(char(m)));
+                if (mask == 0)
+                    continue;
+                const facelet_turn& t = facelet_turns.move[m];
+                for (int k = 0; k < 20; k++)
+                {
+                    __m512i from = _mm512_load_si512(before[t.from[k]].lane);
+                    _mm512_store_si512(block[t.to[k]].lane, _mm512_mask_mov_epi8(_mm512_load_si512(block[t.to[k]].lane), mask, from));
+                }
+            }
+        }
+
+        static bool cpu_has_avx512bw()
+        {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 1);
+            // ZMM, YMM and opmask state saved by the OS
+            if ((info[2] >> 27 & 1) == 0 || (_xgetbv(0) & 0xe6) != 0xe6)
+                return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] >> 16 & 1) != 0 && (info[1] >> 30 & 1) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+        }
+#endif
+
+        // The widest the processor runs, unless $RUBIK_LANE_KERNEL asks for
+        // scalar, avx2 or avx512
+        static lane_kernel pick_lane_kernel()
+        {
+            const char* name = std::getenv("RUBIK_LANE_KERNEL");
+            std::string wanted = name ? name : "";
+#ifdef RUBIK_X86
+            if ((wanted.empty() || wanted == "avx512") && cpu_has_avx512bw())
+                return avx512_lanes;
+            if ((wanted.empty() || wanted == "avx512" || wanted == "avx2") && cpu_has(true))
+                return avx2_lanes;
+#endif
+            return scalar_lanes;
+        }
+
+    private:
+        size_t count;
+        std::vector<row> rows;
+    };
+
+    // How many solutions[i] fail to solve cubes[i], all checked side by
+    // side, one move of every solution per step
+    inline size_t count_unsolved(std::span<const CubeState> cubes, std::span<const MoveSequence> solutions)
+    {
+        size_t n = cubes.size() < solutions.size() ? cubes.size() : solutions.size();
+        cube_batch batch(n);
+        size_t longest = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            batch.set(i, cubes[i]);
+            if (solutions[i].size() > longest)
+                longest = solutions[i].size();
+        }
+        std::vector<Move> step(n);
+        for (size_t s = 0; s < longest; s++)
+        {
+            for (size_t i = 0; i < n; i++)
+                step[i] = s < solutions[i].size() ? solutions[i][s] : cube_batch::NO_MOVE;
+            batch.apply(std::span<const Move>(step));
+        }
+        return n - batch.count_solved();
+    }
+}
+
+#endif
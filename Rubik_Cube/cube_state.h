@@ -0,0 +1,208 @@
+#ifndef CUBE_STATE_H
+#define CUBE_STATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace solver
+{
+    // Faces in the order Rubik::cube_state reads them off the model
+    enum facelet_face { WHITE, ORANGE, GREEN, RED, BLUE, YELLOW };
+
+    // The whole cube as 54 colour letters ('W', 'O', 'G', 'R', 'B', 'Y'),
+    // one 3x3 block per face. Plain value type: copy it, compare it, hand it
+    // to as many threads as you like. Padded to one aligned cache line, so
+    // a move is a shuffle of four 16-byte registers.
+    struct alignas(64) CubeState
+    {
+        char face[6][3][3];
+        char padding[10] = {};
+
+        static CubeState solved()
+        {
+            const char colours[] = "WOGRBY";
+            CubeState state;
+            for (int f = 0; f < 6; f++)
+                for (int i = 0; i < 3; i++)
+                    for (int j = 0; j < 3; j++)
+                        state.face[f][i][j] = colours[f];
+            return state;
+        }
+
+        bool is_solved() const
+        {
+            for (int f = 0; f < 6; f++)
+                for (int i = 0; i < 3; i++)
+                    for (int j = 0; j < 3; j++)
+                        if (face[f][i][j] != face[f][1][1])
+                            return false;
+            return true;
+        }
+
+        bool operator==(const CubeState& other) const
+        {
+            for (int f = 0; f < 6; f++)
+                for (int i = 0; i < 3; i++)
+                    for (int j = 0; j < 3; j++)
+                        if (face[f][i][j] != other.face[f][i][j])
+                            return false;
+            return true;
+        }
+
+        bool operator!=(const CubeState& other) const { return !(*this == other); }
+    };
+
+    static_assert(sizeof(CubeState) == 64, "CubeState is not one cache line");
+
+    // Face turns as compact codes: face * 3 + (quarter turns - 1), faces in
+    // U R F D L B order, so U1 = U, U2 = U2, U3 = U'. The slice turns after
+    // them, E (as D), M (as L) and S (as F), carry the centres along, so
+    // they are only for playing solutions back: the solvers, tables and
+    // simplify() take face turns alone.
+    enum Move : std::uint8_t
+    {
+        U1, U2, U3,
+        R1, R2, R3,
+        F1, F2, F3,
+        D1, D2, D3,
+        L1, L2, L3,
+        B1, B2, B3,
+        MOVE_COUNT,
+        E1 = MOVE_COUNT, E2, E3,
+        M1, M2, M3,
+        S1, S2, S3,
+        TURN_COUNT
+    };
+
+    typedef std::vector<Move> MoveSequence;
+
+    inline int move_face(Move m) { return m / 3; }
+    inline int move_power(Move m) { return m % 3 + 1; }
+    inline Move make_move(int face, int power) { return Move(face * 3 + power - 1); }
+
+    inline std::string move_name(Move m)
+    {
+        std::string name(1, "URFDLBEMS"[move_face(m)]);
+        if (move_power(m) == 2)
+            name += '2';
+        else if (move_power(m) == 3)
+            name += '\'';
+        return name;
+    }
+
+    // Rewrites moves[0, count) in place into an equal sequence in normal
+    // form and returns its length: turns of the same face merged modulo 4,
+    // whole turns dropped, and turns of opposite faces, which commute,
+    // ordered U before D, R before L, F before B, and merged across each
+    // other, so R L R' comes out as L. One pass, the output kept as a stack
+    // whose top holds at most one turn of each face of the last axis.
+    inline size_t simplify(Move* moves, size_t count)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            int face = move_face(moves[i]), power = move_power(moves[i]);
+            // the turn of this face on top of the stack, if any
+            size_t same = n;
+            if (n > 0 && move_face(moves[n - 1]) == face)
+                same = n - 1;
+            else if (n > 1 && move_face(moves[n - 1]) % 3 == face % 3 && move_face(moves[n - 2]) == face)
+                same = n - 2;
+            if (same < n)
+            {
+                power = (power + move_power(moves[same])) % 4;
+                if (power != 0)
+                    moves[same] = make_move(face, power);
+                else
+                {
+                    moves[same] = moves[n - 1];
+                    n--;
+                }
+            }
+            else if (n > 0 && move_face(moves[n - 1]) == face + 3)
+            {
+                moves[n] = moves[n - 1];
+                moves[n - 1] = make_move(face, power);
+                n++;
+            }
+            else
+                moves[n++] = make_move(face, power);
+        }
+        return n;
+    }
+
+    inline MoveSequence simplify(MoveSequence moves)
+    {
+        moves.resize(simplify(moves.data(), moves.size()));
+        return moves;
+    }
+
+    inline std::string to_string(const MoveSequence& moves)
+    {
+        std::string s;
+        for (size_t i = 0; i < moves.size(); i++)
+        {
+            if (i > 0)
+                s += ' ';
+            s += move_name(moves[i]);
+        }
+        return s;
+    }
+
+    // Moves written the way to_string() writes them; false on anything else
+    inline bool parse_moves(const std::string& text, MoveSequence& moves)
+    {
+        moves.clear();
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            if (text[i] == ' ')
+                continue;
+            const char* face = std::strchr("URFDLBEMS", text[i]);
+            if (text[i] == '\0' || face == nullptr)
+                return false;
+            int power = 1;
+            if (i + 1 < text.size() && (text[i + 1] == '2' || text[i + 1] == '\''))
+                power = text[++i] == '2' ? 2 : 3;
+            moves.push_back(make_move(int(face - "URFDLBEMS"), power));
+        }
+        return true;
+    }
+
+    // The same face turns in the slice-turn metric: a face and the one
+    // across from it turned against each other (R L', U2 D2, ...) become one
+    // slice turn. The centres turn with the slice, which turns the whole
+    // cube as far as face names go, so the turns after it are renamed for
+    // where their faces went. The cube still ends solved, though possibly
+    // turned as a whole.
+    inline MoveSequence slice_turns(const MoveSequence& moves)
+    {
+        // where each face goes on a quarter turn of the whole cube by y'
+        // (for E), x' (for M) and z' (for S)
+        static const int turned[3][6] = { { 0, 5, 1, 3, 2, 4 }, { 2, 1, 3, 5, 4, 0 }, { 4, 0, 2, 1, 3, 5 } };
+        int place[6] = { 0, 1, 2, 3, 4, 5 };
+        MoveSequence result;
+        for (size_t i = 0; i < moves.size(); i++)
+        {
+            int face = place[move_face(moves[i])], power = move_power(moves[i]);
+            if (i + 1 < moves.size() && place[move_face(moves[i + 1])] == (face + 3) % 6
+                && (power + move_power(moves[i + 1])) % 4 == 0)
+            {
+                // U^a D^-a = E^a y^a, R^a L^-a = M^a x^a, F^a B^-a = S^-a z^a
+                int axis = face % 3, a = face < 3 ? power : 4 - power;
+                result.push_back(make_move(6 + axis, axis == 2 ? 4 - a : a));
+                for (int k = 0; k < a; k++)
+                    for (int& p : place)
+                        p = turned[axis][p];
+                i++;
+                continue;
+            }
+            result.push_back(make_move(face, power));
+        }
+        return result;
+    }
+}
+
+#endif
@@ -0,0 +1,475 @@
+#ifndef CUBIE_H
+#define CUBIE_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "cube_state.h"
+
+namespace solver
+{
+    enum corner { URF, UFL, ULB, UBR, DFR, DLF, DBL, DRB };
+    enum edge { UR, UF, UL, UB, DR, DF, DL, DB, FR, FL, BL, BR };
+
+    // Facelet indices (face * 9 + row * 3 + column, CubeState face order) of
+    // every corner and edge position. The first facelet of a corner is its
+    // U/D sticker, the other two follow clockwise; the first facelet of an
+    // edge is its U/D sticker, or its F/B sticker for the middle layer edges.
+    constexpr int corner_facelet[8][3] = {
+        { 8, 18, 11 }, { 6, 9, 38 }, { 0, 36, 29 }, { 2, 27, 20 },
+        { 47, 17, 24 }, { 45, 44, 15 }, { 51, 35, 42 }, { 53, 26, 33 }
+    };
+    constexpr int edge_facelet[12][2] = {
+        { 5, 19 }, { 7, 10 }, { 3, 37 }, { 1, 28 }, { 50, 25 }, { 46, 16 },
+        { 48, 43 }, { 52, 34 }, { 14, 21 }, { 12, 41 }, { 32, 39 }, { 30, 23 }
+    };
+
+    inline char& facelet(CubeState& state, int index) { return state.face[index / 9][index % 9 / 3][index % 3]; }
+    inline char facelet(const CubeState& state, int index) { return state.face[index / 9][index % 9 / 3][index % 3]; }
+
+    inline int binomial(int n, int k)
+    {
+        if (k < 0 || k > n)
+            return 0;
+        int r = 1;
+        for (int i = 1; i <= k; i++)
+            r = r * (n - k + i) / i;
+        return r;
+    }
+
+    // The cube at cubie level: which cubie sits in every position and how
+    // it is twisted (corners, 0..2) or flipped (edges, 0..1).
+    struct CubieCube
+    {
+        std::uint8_t cp[8], co[8], ep[12], eo[12];
+
+        static CubieCube solved()
+        {
+            CubieCube c;
+            for (int i = 0; i < 8; i++)
+            {
+                c.cp[i] = i;
+                c.co[i] = 0;
+            }
+            for (int i = 0; i < 12; i++)
+            {
+                c.ep[i] = i;
+                c.eo[i] = 0;
+            }
+            return c;
+        }
+
+        // this = this * b, i.e. apply b after this
+        void corner_multiply(const CubieCube& b)
+        {
+            std::uint8_t p[8], o[8];
+            for (int i = 0; i < 8; i++)
+            {
+                p[i] = cp[b.cp[i]];
+                o[i] = (co[b.cp[i]] + b.co[i]) % 3;
+            }
+            for (int i = 0; i < 8; i++)
+            {
+                cp[i] = p[i];
+                co[i] = o[i];
+            }
+        }
+
+        void edge_multiply(const CubieCube& b)
+        {
+            std::uint8_t p[12], o[12];
+            for (int i = 0; i < 12; i++)
+            {
+                p[i] = ep[b.ep[i]];
+                o[i] = (eo[b.ep[i]] + b.eo[i]) % 2;
+            }
+            for (int i = 0; i < 12; i++)
+            {
+                ep[i] = p[i];
+                eo[i] = o[i];
+            }
+        }
+
+        void multiply(const CubieCube& b)
+        {
+            corner_multiply(b);
+            edge_multiply(b);
+        }
+
+        void move(Move m);
+
+        bool operator==(const CubieCube& other) const
+        {
+            for (int i = 0; i < 8; i++)
+                if (cp[i] != other.cp[i] || co[i] != other.co[i])
+                    return false;
+            for (int i = 0; i < 12; i++)
+                if (ep[i] != other.ep[i] || eo[i] != other.eo[i])
+                    return false;
+            return true;
+        }
+
+        int corner_parity() const
+        {
+            int s = 0;
+            for (int i = 7; i > 0; i--)
+                for (int j = i - 1; j >= 0; j--)
+                    if (cp[j] > cp[i])
+                        s++;
+            return s % 2;
+        }
+
+        int edge_parity() const
+        {
+            int s = 0;
+            for (int i = 11; i > 0; i--)
+                for (int j = i - 1; j >= 0; j--)
+                    if (ep[j] > ep[i])
+                        s++;
+            return s % 2;
+        }
+
+        // twist of the first seven corners, 0..2186
+        int get_twist() const
+        {
+            int r = 0;
+            for (int i = URF; i < DRB; i++)
+                r = 3 * r + co[i];
+            return r;
+        }
+
+        void set_twist(int twist)
+        {
+            int sum = 0;
+            for (int i = DRB - 1; i >= URF; i--)
+            {
+                co[i] = twist % 3;
+                sum += co[i];
+                twist /= 3;
+            }
+            co[DRB] = (3 - sum % 3) % 3;
+        }
+
+        // flip of the first eleven edges, 0..2047
+        int get_flip() const
+        {
+            int r = 0;
+            for (int i = UR; i < BR; i++)
+                r = 2 * r + eo[i];
+            return r;
+        }
+
+        void set_flip(int flip)
+        {
+            int sum = 0;
+            for (int i = BR - 1; i >= UR; i--)
+            {
+                eo[i] = flip % 2;
+                sum += eo[i];
+                flip /= 2;
+            }
+            eo[BR] = (2 - sum % 2) % 2;
+        }
+
+        // positions and order of the FR, FL, BL, BR edges, 0..11879;
+        // values below 24 mean all four are in the middle layer
+        int get_slice_sorted() const
+        {
+            int a = 0, x = 0;
+            int edge4[4];
+            for (int j = BR; j >= UR; j--)
+            {
+                if (ep[j] >= FR)
+                {
+                    a += binomial(11 - j, x + 1);
+                    edge4[3 - x] = ep[j];
+                    x++;
+                }
+            }
+            int b = 0;
+            for (int j = 3; j > 0; j--)
+            {
+                int k = 0;
+                while (edge4[j] != j + 8)
+                {
+                    rotate_left(edge4, 0, j);
+                    k++;
+                }
+                b = (j + 1) * b + k;
+            }
+            return 24 * a + b;
+        }
+
+        void set_slice_sorted(int index)
+        {
+            int slice_edge[4] = { FR, FL, BL, BR };
+            int other_edge[8] = { UR, UF, UL, UB, DR, DF, DL, DB };
+            int b = index % 24;
+            int a = index / 24;
+            for (int i = 0; i < 12; i++)
+                ep[i] = 255;
+            for (int j = 1; j < 4; j++)
+            {
+                int k = b % (j + 1);
+                b /= j + 1;
+                while (k-- > 0)
+                    rotate_right(slice_edge, 0, j);
+            }
+            int x = 4;
+            for (int j = UR; j <= BR; j++)
+            {
+                if (a - binomial(11 - j, x) >= 0)
+                {
+                    ep[j] = slice_edge[4 - x];
+                    a -= binomial(11 - j, x--);
+                }
+            }
+            x = 0;
+            for (int j = UR; j <= BR; j++)
+                if (ep[j] == 255)
+                    ep[j] = other_edge[x++];
+        }
+
+        // permutation of the corners, 0..40319
+        int get_corners() const
+        {
+            int perm[8];
+            for (int i = 0; i < 8; i++)
+                perm[i] = cp[i];
+            return permutation_index(perm, 8);
+        }
+
+        void set_corners(int index)
+        {
+            int perm[8];
+            set_permutation(perm, 8, index);
+            for (int i = 0; i < 8; i++)
+                cp[i] = perm[i];
+        }
+
+        // permutation of the eight U and D layer edges, 0..40319; only
+        // meaningful while the middle layer edges stay in the middle layer
+        int get_ud_edges() const
+        {
+            int perm[8];
+            for (int i = 0; i < 8; i++)
+                perm[i] = ep[i];
+            return permutation_index(perm, 8);
+        }
+
+        void set_ud_edges(int index)
+        {
+            int perm[8];
+            set_permutation(perm, 8, index);
+            for (int i = 0; i < 8; i++)
+                ep[i] = perm[i];
+            for (int i = 8; i < 12; i++)
+                ep[i] = i;
+        }
+
+        static void rotate_left(int* a, int l, int r)
+        {
+            int t = a[l];
+            for (int i = l; i < r; i++)
+                a[i] = a[i + 1];
+            a[r] = t;
+        }
+
+        static void rotate_right(int* a, int l, int r)
+        {
+            int t = a[r];
+            for (int i = r; i > l; i--)
+                a[i] = a[i - 1];
+            a[l] = t;
+        }
+
+        static int permutation_index(int* perm, int n)
+        {
+            int b = 0;
+            for (int j = n - 1; j > 0; j--)
+            {
+                int k = 0;
+                while (perm[j] != j)
+                {
+                    rotate_left(perm, 0, j);
+                    k++;
+                }
+                b = (j + 1) * b + k;
+            }
+            return b;
+        }
+
+        static void set_permutation(int* perm, int n, int index)
+        {
+            for (int i = 0; i < n; i++)
+                perm[i] = i;
+            for (int j = 1; j < n; j++)
+            {
+                int k = index % (j + 1);
+                index /= j + 1;
+                while (k-- > 0)
+                    rotate_right(perm, 0, j);
+            }
+        }
+    };
+
+    // The six clockwise quarter turns U, R, F, D, L, B as cubie cubes
+    constexpr CubieCube basic_moves[6] = {
+        { { UBR, URF, UFL, ULB, DFR, DLF, DBL, DRB }, { 0, 0, 0, 0, 0, 0, 0, 0 },
+          { UB, UR, UF, UL, DR, DF, DL, DB, FR, FL, BL, BR }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } },
+        { { DFR, UFL, ULB, URF, DRB, DLF, DBL, UBR }, { 2, 0, 0, 1, 1, 0, 0, 2 },
+          { FR, UF, UL, UB, BR, DF, DL, DB, DR, FL, BL, UR }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } },
+        { { UFL, DLF, ULB, UBR, URF, DFR, DBL, DRB }, { 1, 2, 0, 0, 2, 1, 0, 0 },
+          { UR, FL, UL, UB, DR, FR, DL, DB, UF, DF, BL, BR }, { 0, 1, 0, 0, 0, 1, 0, 0, 1, 1, 0, 0 } },
+        { { URF, UFL, ULB, UBR, DLF, DBL, DRB, DFR }, { 0, 0, 0, 0, 0, 0, 0, 0 },
+          { UR, UF, UL, UB, DF, DL, DB, DR, FR, FL, BL, BR }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } },
+        { { URF, ULB, DBL, UBR, DFR, UFL, DLF, DRB }, { 0, 1, 2, 0, 0, 2, 1, 0 },
+          { UR, UF, BL, UB, DR, DF, FL, DB, FR, UL, DL, BR }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } },
+        { { URF, UFL, UBR, DRB, DFR, DLF, ULB, DBL }, { 0, 0, 1, 2, 0, 0, 2, 1 },
+          { UR, UF, UL, BR, DR, DF, DL, BL, FR, FL, UB, DB }, { 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1 } }
+    };
+
+    inline const CubieCube& basic_move(int face) { return basic_moves[face]; }
+
+    inline void CubieCube::move(Move m)
+    {
+        for (int i = 0; i < move_power(m); i++)
+            multiply(basic_move(move_face(m)));
+    }
+
+    // Why a facelet cube cannot be solved, in the order check_cube() looks
+    enum class cube_error
+    {
+        none,
+        centres,      // two centres show the same colour
+        colour,       // a sticker matches no centre
+        colour_count, // a colour is not on exactly nine stickers
+        corner,       // a corner shows colours no corner has, or the same corner twice
+        edge,         // the same for an edge
+        twist,        // one corner twisted in place
+        flip,         // one edge flipped in place
+        parity        // two cubies swapped
+    };
+
+    inline const char* error_name(cube_error error)
+    {
+        switch (error)
+        {
+        case cube_error::none: return "none";
+        case cube_error::centres: return "two centres of one colour";
+        case cube_error::colour: return "a colour no centre has";
+        case cube_error::colour_count: return "a colour not on nine stickers";
+        case cube_error::corner: return "an impossible corner";
+        case cube_error::edge: return "an impossible edge";
+        case cube_error::twist: return "a twisted corner";
+        case cube_error::flip: return "a flipped edge";
+        case cube_error::parity: return "two pieces swapped";
+        }
+        return "unknown";
+    }
+
+    // Reads the cubies off the facelets, using the centre colours to tell
+    // which face a sticker belongs to, and says why the cube cannot be
+    // solved if it cannot. Cheap enough to run before every solve.
+    inline cube_error check_cube(const CubeState& state, CubieCube& cube)
+    {
+        const char* facelets = &state.face[0][0][0];
+        std::int8_t face_of[256];
+        std::memset(face_of, -1, sizeof(face_of));
+        for (int f = 0; f < 6; f++)
+        {
+            unsigned char centre = facelets[f * 9 + 4];
+            if (face_of[centre] >= 0)
+                return cube_error::centres;
+            face_of[centre] = std::int8_t(f);
+        }
+        int stickers[6] = {};
+        std::int8_t face[54];
+        for (int i = 0; i < 54; i++)
+        {
+            face[i] = face_of[(unsigned char)facelets[i]];
+            if (face[i] < 0)
+                return cube_error::colour;
+            stickers[face[i]]++;
+        }
+        for (int f = 0; f < 6; f++)
+            if (stickers[f] != 9)
+                return cube_error::colour_count;
+
+        // a cubie by the faces of its stickers: corners by their U/D
+        // sticker's two clockwise neighbours, edges by both faces
+        std::int8_t corner_of[6][6], edge_of[6][6];
+        std::memset(corner_of, -1, sizeof(corner_of));
+        std::memset(edge_of, -1, sizeof(edge_of));
+        for (int j = 0; j < 8; j++)
+            corner_of[corner_facelet[j][1] / 9][corner_facelet[j][2] / 9] = std::int8_t(j);
+        for (int j = 0; j < 12; j++)
+        {
+            edge_of[edge_facelet[j][0] / 9][edge_facelet[j][1] / 9] = std::int8_t(j);
+            edge_of[edge_facelet[j][1] / 9][edge_facelet[j][0] / 9] = std::int8_t(j + 12);
+        }
+
+        int used_corners = 0, used_edges = 0, twist = 0, flip = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            int ori = 0;
+            while (ori < 3 && face[corner_facelet[i][ori]] != WHITE && face[corner_facelet[i][ori]] != YELLOW)
+                ori++;
+            if (ori == 3)
+                return cube_error::corner;
+            int j = corner_of[face[corner_facelet[i][(ori + 1) % 3]]][face[corner_facelet[i][(ori + 2) % 3]]];
+            if (j < 0 || (used_corners >> j & 1))
+                return cube_error::corner;
+            used_corners |= 1 << j;
+            cube.cp[i] = std::uint8_t(j);
+            cube.co[i] = std::uint8_t(ori);
+            twist += ori;
+        }
+        for (int i = 0; i < 12; i++)
+        {
+            int j = edge_of[face[edge_facelet[i][0]]][face[edge_facelet[i][1]]];
+            if (j < 0 || (used_edges >> j % 12 & 1))
+                return cube_error::edge;
+            used_edges |= 1 << j % 12;
+            cube.ep[i] = std::uint8_t(j % 12);
+            cube.eo[i] = std::uint8_t(j / 12);
+            flip += j / 12;
+        }
+
+        if (twist % 3 != 0)
+            return cube_error::twist;
+        if (flip % 2 != 0)
+            return cube_error::flip;
+        if (cube.corner_parity() != cube.edge_parity())
+            return cube_error::parity;
+        return cube_error::none;
+    }
+
+    inline cube_error check_cube(const CubeState& state)
+    {
+        CubieCube cube;
+        return check_cube(state, cube);
+    }
+
+    // The cubies of a cube check_cube() finds nothing wrong with
+    inline bool to_cubie_cube(const CubeState& state, CubieCube& cube)
+    {
+        return check_cube(state, cube) == cube_error::none;
+    }
+
+    // Facelets of a cubie cube, using the standard colours of CubeState::solved
+    inline CubeState to_cube_state(const CubieCube& cube)
+    {
+        CubeState solved = CubeState::solved();
+        CubeState state = solved;
+        for (int i = 0; i < 8; i++)
+            for (int k = 0; k < 3; k++)
+                facelet(state, corner_facelet[i][(k + cube.co[i]) % 3]) = facelet(solved, corner_facelet[cube.cp[i]][k]);
+        for (int i = 0; i < 12; i++)
+            for (int k = 0; k < 2; k++)
+                facelet(state, edge_facelet[i][(k + cube.eo[i]) % 2]) = facelet(solved, edge_facelet[cube.ep[i]][k]);
+        return state;
+    }
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+// Limits for solves that have to answer in time: a search polls its
+// deadline every so many nodes and returns the best it has once it expires.
+namespace solver
+{
+    // Lets one thread tell solves running on others to give up; copies
+    // share the same flag
+    class cancel_token
+    {
+    public:
+        cancel_token() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+        void cancel() const { flag->store(true, std::memory_order_relaxed); }
+        bool cancelled() const { return flag->load(std::memory_order_relaxed); }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> flag;
+    };
+
+    // A point in time after which a solve stops, sooner if its token is
+    // cancelled: deadline(std::chrono::milliseconds(50)) for the window,
+    // deadline(std::chrono::seconds(2)) for a batch job
+    class deadline
+    {
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        explicit deadline(clock::duration budget, cancel_token token = cancel_token())
+            : at(clock::now() + budget), token(token)
+        {
+        }
+
+        // No time limit, only the token
+        explicit deadline(cancel_token token = cancel_token()) : at(clock::time_point::max()), token(token) {}
+
+        bool expired() const { return token.cancelled() || (at != clock::time_point::max() && clock::now() >= at); }
+
+        // Whether there is a time limit at all
+        bool limited() const { return at != clock::time_point::max(); }
+
+        // Whether the token, not the clock, stopped it
+        bool cancelled() const { return token.cancelled(); }
+
+        // Time left; the largest duration without a limit
+        clock::duration remaining() const
+        {
+            if (!limited())
+                return clock::duration::max();
+            clock::time_point now = clock::now();
+            return at > now ? at - now : clock::duration::zero();
+        }
+
+        // The point share of the way from now to this deadline, with the
+        // same token, to give one stage of a solve part of the time
+        deadline part(double share) const
+        {
+            deadline d(*this);
+            clock::time_point now = clock::now();
+            if (limited() && at > now)
+                d.at = now + std::chrono::duration_cast<clock::duration>((at - now) * share);
+            return d;
+        }
+
+    private:
+        clock::time_point at;
+        cancel_token token;
+    };
+}
+
+#endif
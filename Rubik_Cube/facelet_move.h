@@ -0,0 +1,402 @@
+#ifndef FACELET_MOVE_H
+#define FACELET_MOVE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define RUBIK_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// Lets one function use instructions the rest of the build may not assume;
+// MSVC takes any intrinsic without it
+#if defined(__GNUC__)
+#define RUBIK_TARGET(isa) __attribute__((target(isa)))
+#else
+#define RUBIK_TARGET(isa)
+#endif
+
+#include "cube_state.h"
+#include "cubie.h"
+
+// Face turns on the 54 facelets of a CubeState, one permutation table per
+// move. The tables are worked out at compile time from the cubie-level
+// quarter turns, and the static_asserts below check that they really are
+// the face turns: permutations that fix the centres, move 20 facelets
+// each, compose into their own half and inverse turns, and commute with
+// the turns of the opposite face. A move runs as pshufb byte shuffles over
+// the 64-byte state with AVX2 or SSSE3, whichever the processor has, and
+// as 20 byte moves without either.
+namespace solver
+{
+    // After the move, facelet i holds what facelet from[i] held before
+    struct facelet_permutation
+    {
+        std::uint8_t from[54];
+    };
+
+    // a, then b
+    constexpr facelet_permutation compose(const facelet_permutation& a, const facelet_permutation& b)
+    {
+        facelet_permutation r{};
+        for (int i = 0; i < 54; i++)
+            r.from[i] = a.from[b.from[i]];
+        return r;
+    }
+
+    constexpr facelet_permutation identity_permutation()
+    {
+        facelet_permutation r{};
+        for (int i = 0; i < 54; i++)
+            r.from[i] = std::uint8_t(i);
+        return r;
+    }
+
+    // The cubie in position cp[i] moves to position i, turned by co[i], and
+    // takes its stickers along
+    constexpr facelet_permutation quarter_turn(int face)
+    {
+        const CubieCube& c = basic_moves[face];
+        facelet_permutation r = identity_permutation();
+        for (int i = 0; i < 8; i++)
+            for (int k = 0; k < 3; k++)
+                r.from[corner_facelet[i][(k + c.co[i]) % 3]] = std::uint8_t(corner_facelet[c.cp[i]][k]);
+        for (int i = 0; i < 12; i++)
+            for (int k = 0; k < 2; k++)
+                r.from[edge_facelet[i][(k + c.eo[i]) % 2]] = std::uint8_t(edge_facelet[c.ep[i]][k]);
+        return r;
+    }
+
+    struct facelet_move_tables
+    {
+        facelet_permutation move[MOVE_COUNT];
+    };
+
+    constexpr facelet_move_tables make_facelet_moves()
+    {
+        facelet_move_tables t{};
+        for (int f = 0; f < 6; f++)
+        {
+            facelet_permutation p = quarter_turn(f);
+            t.move[f * 3] = p;
+            for (int power = 1; power < 3; power++)
+                t.move[f * 3 + power] = compose(t.move[f * 3 + power - 1], p);
+        }
+        return t;
+    }
+
+    inline constexpr facelet_move_tables facelet_moves = make_facelet_moves();
+
+    namespace facelet_checks
+    {
+        constexpr bool equal(const facelet_permutation& a, const facelet_permutation& b)
+        {
+            for (int i = 0; i < 54; i++)
+                if (a.from[i] != b.from[i])
+                    return false;
+            return true;
+        }
+
+        constexpr bool is_permutation(const facelet_permutation& p)
+        {
+            bool seen[54] = {};
+            for (int i = 0; i < 54; i++)
+            {
+                if (p.from[i] >= 54 || seen[p.from[i]])
+                    return false;
+                seen[p.from[i]] = true;
+            }
+            return true;
+        }
+
+        constexpr bool all_permutations()
+        {
+            for (int m = 0; m < MOVE_COUNT; m++)
+                if (!is_permutation(facelet_moves.move[m]))
+                    return false;
+            return true;
+        }
+
+        constexpr bool centres_fixed()
+        {
+            for (int m = 0; m < MOVE_COUNT; m++)
+                for (int f = 0; f < 6; f++)
+                    if (facelet_moves.move[m].from[f * 9 + 4] != f * 9 + 4)
+                        return false;
+            return true;
+        }
+
+        constexpr bool turns_move_20()
+        {
+            for (int m = 0; m < MOVE_COUNT; m++)
+            {
+                int moved = 0;
+                for (int i = 0; i < 54; i++)
+                    moved += facelet_moves.move[m].from[i] != i;
+                if (moved != 20)
+                    return false;
+            }
+            return true;
+        }
+
+        // X X' and X' X are nothing, X2 is not
+        constexpr bool inverses()
+        {
+            for (int f = 0; f < 6; f++)
+            {
+                const facelet_permutation& x = facelet_moves.move[f * 3];
+                if (!equal(compose(x, facelet_moves.move[f * 3 + 2]), identity_permutation()))
+                    return false;
+                if (!equal(compose(facelet_moves.move[f * 3 + 2], x), identity_permutation()))
+                    return false;
+                if (equal(facelet_moves.move[f * 3 + 1], identity_permutation()))
+                    return false;
+            }
+            return true;
+        }
+
+        // opposite faces commute, neighbouring ones do not
+        constexpr bool commuting_faces()
+        {
+            for (int f = 0; f < 6; f++)
+                for (int g = 0; g < 6; g++)
+                {
+                    const facelet_permutation& a = facelet_moves.move[f * 3];
+                    const facelet_permutation& b = facelet_moves.move[g * 3];
+                    if (equal(compose(a, b), compose(b, a)) != (f % 3 == g % 3))
+                        return false;
+                }
+            return true;
+        }
+
+        static_assert(all_permutations(), "a facelet move is not a permutation");
+        static_assert(centres_fixed(), "a facelet move moves a centre");
+        static_assert(turns_move_20(), "a face turn does not move 20 facelets");
+        static_assert(inverses(), "facelet moves do not invert each other");
+        static_assert(commuting_faces(), "facelet moves commute wrongly");
+    }
+
+    // Any permutation, read from the full table
+    inline void apply(const facelet_permutation& p, CubeState& state)
+    {
+        const char* in = &state.face[0][0][0];
+        CubeState r;
+        char* out = &r.face[0][0][0];
+        for (int i = 0; i < 54; i++)
+            out[i] = in[p.from[i]];
+        state = r;
+    }
+
+    // The 20 facelets a face turn moves, where each goes and where from
+    struct facelet_turn
+    {
+        std::uint8_t to[20], from[20];
+    };
+
+    struct facelet_turn_tables
+    {
+        facelet_turn move[MOVE_COUNT];
+    };
+
+    constexpr facelet_turn_tables make_facelet_turns()
+    {
+        facelet_turn_tables t{};
+        for (int m = 0; m < MOVE_COUNT; m++)
+        {
+            int n = 0;
+            for (int i = 0; i < 54; i++)
+            {
+                if (facelet_moves.move[m].from[i] == i)
+                    continue;
+                t.move[m].to[n] = std::uint8_t(i);
+                t.move[m].from[n] = facelet_moves.move[m].from[i];
+                n++;
+            }
+        }
+        return t;
+    }
+
+    inline constexpr facelet_turn_tables facelet_turns = make_facelet_turns();
+
+    // The one kernel every face turn goes through, expanded per move so all
+    // 40 indices are constants: reads the 20 moving facelets, then writes
+    // them back to where they go
+    template <int M, std::size_t... K>
+    inline void turn(char* c, std::index_sequence<K...>)
+    {
+        constexpr const facelet_turn& t = facelet_turns.move[M];
+        const char moving[20] = { c[t.from[K]]... };
+        ((c[t.to[K]] = moving[K]), ...);
+    }
+
+    template <int M>
+    inline void turn(CubeState& state)
+    {
+        turn<M>(&state.face[0][0][0], std::make_index_sequence<20>());
+    }
+
+    template <std::size_t... M>
+    constexpr auto make_turn_kernels(std::index_sequence<M...>)
+    {
+        typedef void (*kernel)(CubeState&);
+        return std::array<kernel, MOVE_COUNT>{ { &turn<int(M)>... } };
+    }
+
+    inline void scalar_move(CubeState& state, Move m)
+    {
+        static constexpr auto kernels = make_turn_kernels(std::make_index_sequence<MOVE_COUNT>());
+        kernels[m](state);
+    }
+
+    // pshufb masks: the 64 output bytes of a move taken from 16-byte input
+    // chunk k of the state, 0x80 (a zero) where another chunk supplies them.
+    // The padding bytes stay where they are.
+    struct facelet_shuffle_tables
+    {
+        alignas(64) std::uint8_t mask[MOVE_COUNT][4][64];
+    };
+
+    constexpr facelet_shuffle_tables make_facelet_shuffles()
+    {
+        facelet_shuffle_tables t{};
+        for (int m = 0; m < MOVE_COUNT; m++)
+            for (int k = 0; k < 4; k++)
+                for (int i = 0; i < 64; i++)
+                {
+                    int from = i < 54 ? facelet_moves.move[m].from[i] : i;
+                    t.mask[m][k][i] = std::uint8_t(from / 16 == k ? from % 16 : 0x80);
+                }
+        return t;
+    }
+
+    inline constexpr facelet_shuffle_tables facelet_shuffles = make_facelet_shuffles();
+
+#ifdef RUBIK_X86
+    // Every output chunk ORs the shuffles of all four input chunks. The
+    // state stays in registers from the first move to the last.
+    RUBIK_TARGET("ssse3") inline void ssse3_moves(CubeState& state, const Move* moves, size_t count)
+    {
+        __m128i* cube = reinterpret_cast<__m128i*>(&state);
+        __m128i in[4], out[4];
+        for (int k = 0; k < 4; k++)
+            in[k] = _mm_load_si128(cube + k);
+        for (size_t i = 0; i < count; i++)
+        {
+            const __m128i* mask = reinterpret_cast<const __m128i*>(facelet_shuffles.mask[moves[i]]);
+            for (int j = 0; j < 4; j++)
+                out[j] = _mm_or_si128(
+                    _mm_or_si128(_mm_shuffle_epi8(in[0], _mm_load_si128(mask + j)), _mm_shuffle_epi8(in[1], _mm_load_si128(mask + 4 + j))),
+                    _mm_or_si128(_mm_shuffle_epi8(in[2], _mm_load_si128(mask + 8 + j)), _mm_shuffle_epi8(in[3], _mm_load_si128(mask + 12 + j))));
+            for (int k = 0; k < 4; k++)
+                in[k] = out[k];
+        }
+        for (int k = 0; k < 4; k++)
+            _mm_store_si128(cube + k, in[k]);
+    }
+
+    // vpshufb stays within 128-bit lanes, so each input chunk goes to both
+    // lanes and every output half takes four shuffles
+    RUBIK_TARGET("avx2") inline void avx2_moves(CubeState& state, const Move* moves, size_t count)
+    {
+        __m256i* cube = reinterpret_cast<__m256i*>(&state);
+        __m256i low = _mm256_load_si256(cube), high = _mm256_load_si256(cube + 1), out[2];
+        for (size_t i = 0; i < count; i++)
+        {
+            const __m256i* mask = reinterpret_cast<const __m256i*>(facelet_shuffles.mask[moves[i]]);
+            __m256i in[4] = {
+                _mm256_permute2x128_si256(low, low, 0x00), _mm256_permute2x128_si256(low, low, 0x11),
+                _mm256_permute2x128_si256(high, high, 0x00), _mm256_permute2x128_si256(high, high, 0x11)
+            };
+            for (int j = 0; j < 2; j++)
+                out[j] = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_shuffle_epi8(in[0], _mm256_load_si256(mask + j)), _mm256_shuffle_epi8(in[1], _mm256_load_si256(mask + 2 + j))),
+                    _mm256_or_si256(_mm256_shuffle_epi8(in[2], _mm256_load_si256(mask + 4 + j)), _mm256_shuffle_epi8(in[3], _mm256_load_si256(mask + 6 + j))));
+            low = out[0];
+            high = out[1];
+        }
+        _mm256_store_si256(cube, low);
+        _mm256_store_si256(cube + 1, high);
+    }
+
+    inline void ssse3_move(CubeState& state, Move m) { ssse3_moves(state, &m, 1); }
+    inline void avx2_move(CubeState& state, Move m) { avx2_moves(state, &m, 1); }
+
+    inline bool cpu_has(bool avx2)
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        if (!avx2)
+            return (info[2] >> 9 & 1) != 0;
+        // AVX registers saved by the OS, then AVX2 itself
+        if ((info[2] >> 27 & 1) == 0 || (info[2] >> 28 & 1) == 0 || (_xgetbv(0) & 6) != 6)
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] >> 5 & 1) != 0;
+#else
+        __builtin_cpu_init();
+        return avx2 ? __builtin_cpu_supports("avx2") : __builtin_cpu_supports("ssse3");
+#endif
+    }
+#endif
+
+    inline void scalar_moves(CubeState& state, const Move* moves, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            scalar_move(state, moves[i]);
+    }
+
+    struct move_kernels
+    {
+        void (*one)(CubeState&, Move);
+        void (*many)(CubeState&, const Move*, size_t);
+    };
+
+    // The fastest kernels the processor runs, unless $RUBIK_MOVE_KERNEL
+    // asks for scalar, ssse3 or avx2. The scalar kernel jumps to code of
+    // its own for every move, a branch random moves keep mispredicting;
+    // the shuffles run the same code for every move.
+    inline move_kernels pick_move_kernels()
+    {
+        const char* name = std::getenv("RUBIK_MOVE_KERNEL");
+        std::string wanted = name ? name : "";
+#ifdef RUBIK_X86
+        if ((wanted.empty() || wanted == "avx2") && cpu_has(true))
+            return { avx2_move, avx2_moves };
+        if ((wanted.empty() || wanted == "avx2" || wanted == "ssse3") && cpu_has(false))
+            return { ssse3_move, ssse3_moves };
+#endif
+        return { scalar_move, scalar_moves };
+    }
+
+    inline const move_kernels& selected_move_kernels()
+    {
+        static const move_kernels kernels = pick_move_kernels();
+        return kernels;
+    }
+
+    inline void apply_move(CubeState& state, Move m)
+    {
+        selected_move_kernels().one(state, m);
+    }
+
+    inline void apply_moves(CubeState& state, const Move* moves, size_t count)
+    {
+        selected_move_kernels().many(state, moves, count);
+    }
+
+    inline void apply_moves(CubeState& state, const MoveSequence& moves)
+    {
+        apply_moves(state, moves.data(), moves.size());
+    }
+}
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef MEET_IN_MIDDLE_H
+#define MEET_IN_MIDDLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "cubie.h"
+#include "table_cache.h"
+#include "transposition.h"
+
+// Optimal solutions for cubes a few moves from solved, the ones scrambled
+// by hand in the window. Every state within DEPTH moves of solved is in a
+// hash table, with its distance and a move that takes it one step closer;
+// a short forward search from the cube stops at the first state it finds
+// there. Forward depths are tried in order, so the first hit is optimal.
+namespace solver
+{
+    namespace meet_in_middle
+    {
+        // 621,649 states lie within five moves of solved
+        const int DEPTH = 5;
+        const int SLOTS = 1 << 20;
+
+        // Forward depth the solver tries before its heavy engines: up to
+        // eight moves from solved the meeting costs at most some 80 us,
+        // about what the optimal search takes; beyond that it loses
+        const int FORWARD = 3;
+
+        struct tables
+        {
+            // open addressing on the Zobrist hash: the hash with its low
+            // byte replaced by (distance + 1) << 5 | move towards solved,
+            // 0 for an empty slot
+            std::uint64_t slot[SLOTS];
+
+            void build()
+            {
+                for (int i = 0; i < SLOTS; i++)
+                    slot[i] = 0;
+                std::vector<hashed_cube> frontier(1, hashed_cube(CubieCube::solved()));
+                insert(frontier[0].hash, 0, 0);
+                for (int d = 0; d < DEPTH; d++)
+                {
+                    std::vector<hashed_cube> next;
+                    for (const hashed_cube& c : frontier)
+                    {
+                        for (int m = 0; m < MOVE_COUNT; m++)
+                        {
+                            hashed_cube n = c;
+                            n.move(Move(m));
+                            int distance, back;
+                            if (find(n.hash, distance, back))
+                                continue;
+                            // the inverse turn of the same face leads back
+                            insert(n.hash, d + 1, make_move(move_face(Move(m)), 4 - move_power(Move(m))));
+                            next.push_back(n);
+                        }
+                    }
+                    frontier.swap(next);
+                }
+            }
+
+            bool find(std::uint64_t hash, int& distance, int& towards_solved) const
+            {
+                for (std::uint32_t i = std::uint32_t(hash >> 32) & (SLOTS - 1);; i = (i + 1) & (SLOTS - 1))
+                {
+                    if (slot[i] == 0)
+                        return false;
+                    if ((slot[i] ^ hash) >> 8 == 0)
+                    {
+                        distance = int(slot[i] >> 5 & 7) - 1;
+                        towards_solved = int(slot[i] & 31);
+                        return true;
+                    }
+                }
+            }
+
+            // Layout and contents of the cached table file
+            static const std::uint32_t VERSION = 1;
+
+            static const tables& get()
+            {
+                static const tables* instance = table_cache::load<tables>("meet_in_middle", VERSION, create);
+                return *instance;
+            }
+
+        private:
+            static const tables* create()
+            {
+                tables* t = new tables;
+                t->build();
+                return t;
+            }
+
+            void insert(std::uint64_t hash, int distance, int towards_solved)
+            {
+                std::uint32_t i = std::uint32_t(hash >> 32) & (SLOTS - 1);
+                while (slot[i] != 0)
+                    i = (i + 1) & (SLOTS - 1);
+                slot[i] = (hash & ~std::uint64_t(255)) | std::uint64_t((distance + 1) << 5 | towards_solved);
+            }
+        };
+
+        class search
+        {
+        public:
+            explicit search(const CubieCube& cube) : t(tables::get()), root(cube) {}
+
+            // The shortest solution, if the cube is at most
+            // DEPTH + max_forward moves from solved
+            bool run(int max_forward, MoveSequence& result)
+            {
+                result.clear();
+                if (walk_back(root, result))
+                    return true;
+                // a cube no nearer than DEPTH + f moves meets the table, if
+                // at all, at a state exactly DEPTH moves out
+                for (int f = 1; f <= max_forward; f++)
+                {
+                    path.clear();
+                    if (dfs(root, f, -1, result))
+                        return true;
+                }
+                result.clear();
+                return false;
+            }
+
+        private:
+            const tables& t;
+            hashed_cube root;
+            MoveSequence path;
+
+            bool dfs(const hashed_cube& c, int depth_left, int last_face, MoveSequence& result)
+            {
+                if (depth_left == 0)
+                {
+                    int distance, move;
+                    if (!t.find(c.hash, distance, move) || distance != DEPTH)
+                        return false;
+                    result = path;
+                    return walk_back(c, result);
+                }
+                for (int m = 0; m < MOVE_COUNT; m++)
+                {
+                    int face = move_face(Move(m));
+                    if (face == last_face || face == last_face - 3)
+                        continue;
+                    hashed_cube n = c;
+                    n.move(Move(m));
+                    path.push_back(Move(m));
+                    bool found = dfs(n, depth_left - 1, face, result);
+                    path.pop_back();
+                    if (found)
+                        return true;
+                }
+                return false;
+            }
+
+            // Appends the table's way from c to solved; false on a hash that
+            // only looked like a table state
+            bool walk_back(hashed_cube c, MoveSequence& result) const
+            {
+                size_t start = result.size();
+                int distance, move;
+                for (int steps = 0; steps < DEPTH && t.find(c.hash, distance, move) && distance > 0; steps++)
+                {
+                    c.move(Move(move));
+                    result.push_back(Move(move));
+                }
+                if (t.find(c.hash, distance, move) && distance == 0 && c.cube == CubieCube::solved())
+                    return true;
+                result.resize(start);
+                return false;
+            }
+        };
+
+        // An optimal solution of a cube at most DEPTH + max_forward moves
+        // from solved; false for a cube further out
+        inline bool solve(const CubieCube& cube, int max_forward, MoveSequence& result)
+        {
+            search s(cube);
+            return s.run(max_forward, result);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef MOVE_TRACKER_H
+#define MOVE_TRACKER_H
+
+#include "cube_state.h"
+#include "facelet_move.h"
+
+// Solving again without a search. The tracker holds the last cube whose
+// solution is known and the turns made on it since; the cube they lead to
+// is solved by undoing them and then playing the known solution, the two
+// run through simplify() as one sequence. That only pays while the turns
+// are few, so solve() gives up past a length and the caller searches.
+namespace solver
+{
+    class move_tracker
+    {
+    public:
+        // Turns beyond this many are not worth undoing
+        static const size_t MAX_TURNS = 256;
+
+        // Starts from a solved cube
+        move_tracker() { reset(CubeState::solved(), MoveSequence()); }
+
+        // A cube and moves that solve it, to count turns from
+        void reset(const CubeState& state, const MoveSequence& solution)
+        {
+            now = state;
+            this->solution = solution;
+            turns.clear();
+            known = true;
+        }
+
+        // Nothing known until the next reset(), so solve() always defers
+        // to a search
+        void forget() { known = false; }
+
+        // A turn made on the cube. A slice turn moves the centres, which
+        // the face turns of the solution are named by, so it forgets the
+        // solution, as do too many turns.
+        void turned(Move m)
+        {
+            if (m >= MOVE_COUNT)
+                known = false;
+            if (!known)
+                return;
+            apply_move(now, m);
+            turns.push_back(m);
+            turns.resize(simplify(turns.data(), turns.size()));
+            if (turns.size() > MAX_TURNS)
+                known = false;
+        }
+
+        // Moves that solve state, if it is the cube the turns led to and
+        // undoing them then solving comes to at most max_length moves
+        bool solve(const CubeState& state, size_t max_length, MoveSequence& moves) const
+        {
+            if (!known || state != now)
+                return false;
+            moves.clear();
+            for (size_t i = turns.size(); i-- > 0;)
+                moves.push_back(make_move(move_face(turns[i]), 4 - move_power(turns[i])));
+            moves.insert(moves.end(), solution.begin(), solution.end());
+            moves.resize(simplify(moves.data(), moves.size()));
+            return moves.size() <= max_length;
+        }
+
+    private:
+        bool known;
+        CubeState now;          // the cube after the turns
+        MoveSequence solution;  // solves the cube before them
+        MoveSequence turns;     // simplified
+    };
+}
+
+#endif
@@ -0,0 +1,362 @@
+#ifndef OPTIMAL_H
+#define OPTIMAL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "coordinate.h"
+#include "cubie.h"
+#include "deadline.h"
+#include "pruning.h"
+#include "symmetry.h"
+#include "table_cache.h"
+#include "thread_pool.h"
+#include "transposition.h"
+#include "two_phase.h"
+
+// Korf's optimal solver: iterative-deepening A* whose heuristic is the
+// largest of three pattern databases, the exact distance of the corners and
+// of two groups of six edges each. The 18 subtrees below the root are
+// searched in parallel on the shared thread pool.
+namespace solver
+{
+    namespace optimal
+    {
+        const int N_CORNER_STATES = symmetry::N_CORNER_CLASSES * two_phase::N_TWIST;
+        const int N_EDGE_PERM = 12 * 11 * 10 * 9 * 8 * 7;
+        const int N_EDGE_STATES = N_EDGE_PERM * 64;
+
+        // The two edge groups: UR..DF and DL..BR
+        const int edge_group_first[2] = { UR, DL };
+
+        // Positions of six tracked edges as a dense index 0..665279: each
+        // position is numbered among the positions not used by earlier edges
+        inline int rank_edge_positions(const int* pos) { return coordinate::rank<12, 6>(pos); }
+        inline void unrank_edge_positions(int r, int* pos) { coordinate::unrank<12, 6>(r, pos); }
+
+        // Edge group coordinate of a cube: position index * 64 + flips
+        inline int edge_group_index(const CubieCube& cube, int group)
+        {
+            int pos[6], flips = 0;
+            for (int i = 0; i < 12; i++)
+            {
+                int k = cube.ep[i] - edge_group_first[group];
+                if (k >= 0 && k < 6)
+                {
+                    pos[k] = i;
+                    flips |= cube.eo[i] << k;
+                }
+            }
+            return rank_edge_positions(pos) * 64 + flips;
+        }
+
+        struct tables
+        {
+            // new position index << 6 | flips the move adds, for six edges
+            std::uint32_t edge_move[N_EDGE_PERM][MOVE_COUNT];
+
+            // distances modulo 3 of the corners (symmetry class * 2187 +
+            // twist conjugated the same way) and of each edge group
+            std::uint8_t corner_prun[pruning::bytes(N_CORNER_STATES)];
+            std::uint8_t edge_prun[2][pruning::bytes(N_EDGE_STATES)];
+
+            void build()
+            {
+                build_edge_move();
+                const symmetry::tables& sym = symmetry::tables::get();
+                pruning::build(corner_prun, N_CORNER_STATES, 0, MOVE_COUNT, [&](std::int64_t i, int m) { return corner_next(int(i), m); });
+                // the search looks up states without making them canonical
+                for (int i = 0; i < N_CORNER_STATES; i++)
+                {
+                    int corner_class = i / two_phase::N_TWIST;
+                    int canonical = corner_class * two_phase::N_TWIST + sym.canonical_twist(corner_class, i % two_phase::N_TWIST);
+                    pruning::set(corner_prun, i, pruning::get(corner_prun, canonical));
+                }
+                for (int g = 0; g < 2; g++)
+                    pruning::build(edge_prun[g], N_EDGE_STATES, edge_goal(g), MOVE_COUNT, [&](std::int64_t i, int m) { return edge_next(int(i), m); });
+            }
+
+            static int corner_index(const symmetry::tables& sym, int corners, int twist)
+            {
+                return sym.corner_class[corners] * two_phase::N_TWIST + sym.twist_conj[twist][sym.corner_sym[corners]];
+            }
+
+            // canonical entry of a successor
+            int corner_next(int i, int m) const
+            {
+                const two_phase::tables& tp = two_phase::tables::get();
+                const symmetry::tables& sym = symmetry::tables::get();
+                int corners = tp.corners_move[sym.corner_rep[i / two_phase::N_TWIST]][m];
+                int twist = tp.twist_move[i % two_phase::N_TWIST][m];
+                int corner_class = sym.corner_class[corners];
+                return corner_class * two_phase::N_TWIST + sym.canonical_twist(corner_class, sym.twist_conj[twist][sym.corner_sym[corners]]);
+            }
+
+            int edge_next(int i, int m) const
+            {
+                std::uint32_t e = edge_move[i >> 6][m];
+                return int(e >> 6) * 64 + ((i & 63) ^ (e & 63));
+            }
+
+            static int edge_goal(int group) { return edge_group_index(CubieCube::solved(), group); }
+
+            // Exact distances, for the root of a search
+            int corner_distance(int i) const
+            {
+                return pruning::distance(corner_prun, i, 0, MOVE_COUNT, [&](std::int64_t j, int m) { return corner_next(int(j), m); });
+            }
+
+            int edge_distance(int group, int i) const
+            {
+                return pruning::distance(edge_prun[group], i, edge_goal(group), MOVE_COUNT, [&](std::int64_t j, int m) { return edge_next(int(j), m); });
+            }
+
+            // Layout and contents of the cached table file
+            static const std::uint32_t VERSION = 3;
+
+            // Mapped from the table cache, or built and cached, on first use;
+            // safe to call from several threads at once
+            static const tables& get()
+            {
+                static const tables* instance = table_cache::load<tables>("optimal", VERSION, create);
+                return *instance;
+            }
+
+        private:
+            static const tables* create()
+            {
+                tables* t = new tables;
+                t->build();
+                return t;
+            }
+
+            void build_edge_move()
+            {
+                // where the edge at each position goes, and whether it flips
+                int dest[MOVE_COUNT][12], flip[MOVE_COUNT][12];
+                for (int m = 0; m < MOVE_COUNT; m++)
+                {
+                    CubieCube c = CubieCube::solved();
+                    c.move(Move(m));
+                    for (int i = 0; i < 12; i++)
+                    {
+                        dest[m][c.ep[i]] = i;
+                        flip[m][c.ep[i]] = c.eo[i];
+                    }
+                }
+                for (int r = 0; r < N_EDGE_PERM; r++)
+                {
+                    int pos[6], next[6];
+                    unrank_edge_positions(r, pos);
+                    for (int m = 0; m < MOVE_COUNT; m++)
+                    {
+                        int flips = 0;
+                        for (int k = 0; k < 6; k++)
+                        {
+                            next[k] = dest[m][pos[k]];
+                            flips |= flip[m][pos[k]] << k;
+                        }
+                        edge_move[r][m] = std::uint32_t(rank_edge_positions(next)) << 6 | flips;
+                    }
+                }
+            }
+        };
+
+        // Coordinates the search carries along instead of a whole cube, with
+        // the exact distance of the corners and of each edge group
+        struct node
+        {
+            int corners, twist;
+            int edges[2];
+            int distance[3];
+        };
+
+        class search
+        {
+        public:
+            search(const CubieCube& cube, bool find_all, transposition_table* table = transposition_table::shared())
+                : find_all(find_all), t(tables::get()), tp(two_phase::tables::get()), sym(symmetry::tables::get()), cube(cube), table(table),
+                  search_id(table ? table->new_search() : 0)
+            {
+                root.corners = cube.get_corners();
+                root.twist = cube.get_twist();
+                for (int g = 0; g < 2; g++)
+                    root.edges[g] = edge_group_index(cube, g);
+                root.distance[0] = t.corner_distance(tables::corner_index(sym, root.corners, root.twist));
+                for (int g = 0; g < 2; g++)
+                    root.distance[g + 1] = t.edge_distance(g, root.edges[g]);
+            }
+
+            // Every optimal solution (or just the first one found), all of
+            // the same length; empty if the cube needs more than max_depth
+            // or the search runs past limit
+            std::vector<MoveSequence> run(int max_depth = 20, const deadline* limit = nullptr)
+            {
+                if (heuristic(root) == 0)
+                    return std::vector<MoveSequence>(1);
+                this->limit = limit;
+                thread_pool& pool = thread_pool::shared();
+                for (int bound = heuristic(root); bound <= max_depth && solutions.empty() && !stop; bound++)
+                {
+                    task_group group(pool);
+                    for (int m = 0; m < MOVE_COUNT; m++)
+                    {
+                        group.submit([this, m, bound]
+                        {
+                            Move path[32];
+                            path[0] = Move(m);
+                            if (!table || bound - 1 < TABLE_DEPTH)
+                            {
+                                dfs(apply(root, m), bound - 1, path, 1);
+                                return;
+                            }
+                            node child = apply(root, m);
+                            if (cut(child, bound - 1))
+                                return;
+                            hashed_cube next = cube;
+                            next.move(Move(m));
+                            transposition_table::counters count;
+                            tabled_dfs(child, next, bound - 1, path, 1, count);
+                            table->add(count);
+                        });
+                    }
+                    group.wait();
+                }
+                return solutions;
+            }
+
+        private:
+            bool find_all;
+            const tables& t;
+            const two_phase::tables& tp;
+            const symmetry::tables& sym;
+            node root;
+            hashed_cube cube;
+            transposition_table* table;
+            std::uint32_t search_id;
+            std::atomic<bool> stop{ false };
+            std::atomic<int> found{ 0 };
+            const deadline* limit = nullptr;
+            std::mutex solutions_mutex;
+            std::vector<MoveSequence> solutions;
+
+            node apply(const node& n, int m) const
+            {
+                node r;
+                r.corners = tp.corners_move[n.corners][m];
+                r.twist = tp.twist_move[n.twist][m];
+                r.distance[0] = pruning::next_distance(n.distance[0], pruning::get(t.corner_prun, tables::corner_index(sym, r.corners, r.twist)));
+                for (int g = 0; g < 2; g++)
+                {
+                    r.edges[g] = t.edge_next(n.edges[g], m);
+                    r.distance[g + 1] = pruning::next_distance(n.distance[g + 1], pruning::get(t.edge_prun[g], r.edges[g]));
+                }
+                return r;
+            }
+
+            int heuristic(const node& n) const
+            {
+                return std::max(n.distance[0], std::max(n.distance[1], n.distance[2]));
+            }
+
+            // Whether there is no point going below n: the search is over,
+            // or the pruning tables say the leaves are out of reach
+            bool cut(const node& n, int depth_left)
+            {
+                if (stop.load(std::memory_order_relaxed))
+                    return true;
+                // nodes this far from the leaves are few enough to read the clock at
+                if (limit && depth_left >= 3 && limit->expired())
+                {
+                    stop = true;
+                    return true;
+                }
+                return heuristic(n) > depth_left;
+            }
+
+            void dfs(const node& n, int depth_left, Move* path, int length)
+            {
+                if (cut(n, depth_left))
+                    return;
+                if (heuristic(n) == 0 && depth_left == 0)
+                {
+                    std::lock_guard<std::mutex> lock(solutions_mutex);
+                    solutions.push_back(MoveSequence(path, path + length));
+                    found++;
+                    if (!find_all)
+                        stop = true;
+                    return;
+                }
+                int last_face = move_face(path[length - 1]);
+                for (int m = 0; m < MOVE_COUNT; m++)
+                {
+                    int face = move_face(Move(m));
+                    if (face == last_face || face == last_face - 3)
+                        continue;
+                    path[length] = Move(m);
+                    dfs(apply(n, m), depth_left - 1, path, length + 1);
+                }
+            }
+
+            // Nodes at least this many moves from the leaves go through the
+            // transposition table; nearer the leaves a probe costs more than
+            // the subtree it could cut
+            static const int TABLE_DEPTH = 5;
+
+            // dfs() with the position tracked as cubies too, down to
+            // TABLE_DEPTH, for a node cut() has passed. A position's entry
+            // is keyed by the face of the last move as well, since that
+            // decides which moves come next.
+            void tabled_dfs(const node& n, const hashed_cube& cube, int depth_left, Move* path, int length, transposition_table::counters& count)
+            {
+                int last_face = move_face(path[length - 1]);
+                std::uint64_t key = cube.hash ^ zobrist.last_face[last_face];
+                if (table->probe(key, search_id, depth_left, count))
+                    return;
+                int found_before = found.load(std::memory_order_relaxed);
+                for (int m = 0; m < MOVE_COUNT; m++)
+                {
+                    int face = move_face(Move(m));
+                    if (face == last_face || face == last_face - 3)
+                        continue;
+                    path[length] = Move(m);
+                    if (depth_left - 1 < TABLE_DEPTH)
+                    {
+                        dfs(apply(n, m), depth_left - 1, path, length + 1);
+                        continue;
+                    }
+                    // most nodes are cut, so the cubies are only moved for the rest
+                    node child = apply(n, m);
+                    if (cut(child, depth_left - 1))
+                        continue;
+                    hashed_cube next = cube;
+                    next.move(Move(m));
+                    tabled_dfs(child, next, depth_left - 1, path, length + 1, count);
+                }
+                // a subtree cut short may still hold a solution
+                if (!stop.load(std::memory_order_relaxed) && found.load(std::memory_order_relaxed) == found_before)
+                    table->store(key, search_id, depth_left, count);
+            }
+        };
+
+        // Shortest solutions of a cube: the first one found, or all of them
+        inline std::vector<MoveSequence> solve(const CubieCube& cube, bool find_all)
+        {
+            search s(cube, find_all);
+            return s.run();
+        }
+
+        // The first shortest solution, or nothing if the deadline comes first
+        // or the cube needs more than max_length moves
+        inline std::vector<MoveSequence> solve(const CubieCube& cube, const deadline& limit, int max_length = 20)
+        {
+            search s(cube, false);
+            return s.run(max_length, &limit);
+        }
+    }
+}
+
+#endif
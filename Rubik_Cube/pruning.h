@@ -0,0 +1,155 @@
+#ifndef PRUNING_H
+#define PRUNING_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "thread_pool.h"
+
+// Pruning tables packed four entries to a byte. An entry holds the distance
+// to the goal modulo 3 (3 while the table is being built and the entry is
+// not reached yet). Neighbouring entries are at most one move apart, so a
+// search that knows the exact distance of a state recovers the exact
+// distance of every successor from its residue alone, and the exact
+// distance of a start state comes from walking it down to the goal.
+namespace solver
+{
+    namespace pruning
+    {
+        const int EMPTY = 3;
+
+        constexpr std::int64_t bytes(std::int64_t size) { return (size + 3) / 4; }
+
+        inline int get(const std::uint8_t* table, std::int64_t i)
+        {
+            return (table[i >> 2] >> ((i & 3) * 2)) & 3;
+        }
+
+        inline void set(std::uint8_t* table, std::int64_t i, int value)
+        {
+            int shift = int(i & 3) * 2;
+            table[i >> 2] = std::uint8_t((table[i >> 2] & ~(3 << shift)) | (value << shift));
+        }
+
+        // Exact distance of a successor of a state at the given distance
+        inline int next_distance(int distance, int residue)
+        {
+            static const int step[3][3] = { { 0, 1, -1 }, { -1, 0, 1 }, { 1, -1, 0 } };
+            return distance + step[distance % 3][residue];
+        }
+
+        // Exact distance of an entry: the number of steps down to the goal,
+        // each to a successor whose residue is one less
+        template <typename Successor>
+        int distance(const std::uint8_t* table, std::int64_t i, std::int64_t goal, int move_count, Successor next)
+        {
+            int d = 0;
+            while (i != goal)
+            {
+                int down = (get(table, i) + 2) % 3;
+                for (int k = 0; k < move_count; k++)
+                {
+                    std::int64_t j = next(i, k);
+                    if (get(table, j) == down)
+                    {
+                        i = j;
+                        break;
+                    }
+                }
+                d++;
+            }
+            return d;
+        }
+
+        // Reads and claims for entries other threads may be writing
+        inline int load(const std::uint8_t* table, std::int64_t i)
+        {
+            std::atomic_ref<std::uint8_t> byte(const_cast<std::uint8_t&>(table[i >> 2]));
+            return (byte.load(std::memory_order_relaxed) >> ((i & 3) * 2)) & 3;
+        }
+
+        // Sets an entry that is empty or already holds value; true if it
+        // was empty
+        inline bool claim(std::uint8_t* table, std::int64_t i, int value)
+        {
+            int shift = int(i & 3) * 2;
+            std::atomic_ref<std::uint8_t> byte(table[i >> 2]);
+            int old = byte.fetch_and(std::uint8_t(~((EMPTY ^ value) << shift)), std::memory_order_relaxed);
+            return (old >> shift & 3) == EMPTY;
+        }
+
+        // Breadth-first search from the goal over move_count moves, each of
+        // which must have its inverse among them, one level at a time with
+        // large tables split across the shared thread pool. Once most
+        // entries are known it looks from the unknown ones back instead of
+        // expanding the frontier; then every thread writes only entries of
+        // its own part. Entries three levels back share the frontier's
+        // residue; expanding them again finds nothing new.
+        template <typename Successor>
+        void build(std::uint8_t* table, std::int64_t size, std::int64_t goal, int move_count, Successor next)
+        {
+            std::memset(table, 0xff, bytes(size));
+            set(table, goal, 0);
+            std::int64_t known = 1;
+            // below this the atomics cost more than the threads bring
+            bool threaded = thread_pool::shared().size() > 1 && size >= (std::int64_t(1) << 22);
+            for (int depth = 0;; depth++)
+            {
+                int current = depth % 3, following = (depth + 1) % 3;
+                bool backward = known > size / 2;
+                int wanted = backward ? EMPTY : current;
+                std::atomic<std::int64_t> level_found{ 0 };
+                auto scan = [&](std::int64_t first, std::int64_t last)
+                {
+                    std::int64_t count = 0;
+                    for (std::int64_t byte = first; byte < last; byte++)
+                    {
+                        // low bit of every 2-bit field holding the wanted value
+                        int x = std::atomic_ref<std::uint8_t>(table[byte]).load(std::memory_order_relaxed) ^ ((3 - wanted) * 0x55);
+                        int matches = x & (x >> 1) & 0x55;
+                        for (int e = 0; e < 4; e++)
+                        {
+                            std::int64_t i = byte * 4 + e;
+                            if (!(matches >> (e * 2) & 1) || i >= size)
+                                continue;
+                            for (int k = 0; k < move_count; k++)
+                            {
+                                std::int64_t j = next(i, k);
+                                if (backward && load(table, j) == current)
+                                {
+                                    if (threaded)
+                                        claim(table, i, following);
+                                    else
+                                        set(table, i, following);
+                                    count++;
+                                    break;
+                                }
+                                if (!backward && load(table, j) == EMPTY)
+                                {
+                                    if (threaded)
+                                        count += claim(table, j, following);
+                                    else
+                                    {
+                                        set(table, j, following);
+                                        count++;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                    level_found += count;
+                };
+                if (threaded)
+                    thread_pool::shared().parallel_for(bytes(size), 1 << 12, scan);
+                else
+                    scan(0, bytes(size));
+                if (level_found == 0)
+                    break;
+                known += level_found;
+            }
+        }
+    }
+}
+
+#endif
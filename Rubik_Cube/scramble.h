@@ -0,0 +1,220 @@
+#ifndef SCRAMBLE_H
+#define SCRAMBLE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "cubie.h"
+#include "table_cache.h"
+#include "thread_pool.h"
+
+// Uniformly random cubes, and corpora of them on disk for benchmarks to
+// replay. A random walk of moves favours cubes near where it started; these
+// draw the corner and edge permutations and orientations directly, with
+// the edge parity matched to the corners and the last twist and flip
+// making the sums come out right, so every solvable cube is equally
+// likely. A corpus is a header and then one fixed 20-byte record per cube,
+// a byte per cubie, so it is read by mapping the file and indexing it.
+namespace solver
+{
+    namespace scramble
+    {
+        // splitmix64: small, fast, and any seed is a good one
+        struct random_source
+        {
+            std::uint64_t state;
+
+            explicit random_source(std::uint64_t seed) : state(seed) {}
+
+            std::uint64_t next()
+            {
+                std::uint64_t z = state += 0x9e3779b97f4a7c15ull;
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+                return z ^ (z >> 31);
+            }
+
+            // 0..n-1, by multiply and shift; the bias is below n / 2^32
+            std::uint32_t below(std::uint32_t n) { return std::uint32_t((next() >> 32) * n >> 32); }
+        };
+
+        // A uniformly random solvable cube
+        inline CubieCube random_cube(random_source& rng)
+        {
+            CubieCube c = CubieCube::solved();
+            // Fisher-Yates, counting the swaps for the parity
+            int parity = 0;
+            for (int i = 7; i > 0; i--)
+            {
+                int j = int(rng.below(i + 1));
+                std::uint8_t t = c.cp[i];
+                c.cp[i] = c.cp[j];
+                c.cp[j] = t;
+                parity ^= j != i;
+            }
+            for (int i = 11; i > 0; i--)
+            {
+                int j = int(rng.below(i + 1));
+                std::uint8_t t = c.ep[i];
+                c.ep[i] = c.ep[j];
+                c.ep[j] = t;
+                parity ^= j != i;
+            }
+            // a swap of two edges pairs every cube of the wrong parity with
+            // one of the right parity, so they stay equally likely
+            if (parity)
+            {
+                std::uint8_t t = c.ep[0];
+                c.ep[0] = c.ep[1];
+                c.ep[1] = t;
+            }
+            int twist = int(rng.below(2187)), sum = 0;
+            for (int i = DBL; i >= URF; i--)
+            {
+                c.co[i] = std::uint8_t(twist % 3);
+                sum += twist % 3;
+                twist /= 3;
+            }
+            c.co[DRB] = std::uint8_t((3 - sum % 3) % 3);
+            std::uint32_t flip = std::uint32_t(rng.next()) & 0x7ff;
+            sum = 0;
+            for (int i = UR; i < BR; i++)
+            {
+                c.eo[i] = std::uint8_t(flip >> i & 1);
+                sum += c.eo[i];
+            }
+            c.eo[BR] = std::uint8_t(sum & 1);
+            return c;
+        }
+
+        // One cube of a corpus: the cubie and twist of every corner position
+        // as cp | co << 3, the cubie and flip of every edge as ep | eo << 4
+        struct record
+        {
+            std::uint8_t corner[8];
+            std::uint8_t edge[12];
+        };
+
+        static_assert(sizeof(record) == 20, "scramble records are 20 bytes");
+
+        inline record pack(const CubieCube& c)
+        {
+            record r;
+            for (int i = 0; i < 8; i++)
+                r.corner[i] = std::uint8_t(c.cp[i] | c.co[i] << 3);
+            for (int i = 0; i < 12; i++)
+                r.edge[i] = std::uint8_t(c.ep[i] | c.eo[i] << 4);
+            return r;
+        }
+
+        inline CubieCube unpack(const record& r)
+        {
+            CubieCube c;
+            for (int i = 0; i < 8; i++)
+            {
+                c.cp[i] = r.corner[i] & 7;
+                c.co[i] = r.corner[i] >> 3;
+            }
+            for (int i = 0; i < 12; i++)
+            {
+                c.ep[i] = r.edge[i] & 15;
+                c.eo[i] = r.edge[i] >> 4;
+            }
+            return c;
+        }
+
+        const char MAGIC[8] = { 'R', 'U', 'B', 'I', 'K', 'S', 'C', 'R' };
+        const std::uint32_t VERSION = 1;
+
+        struct header
+        {
+            char magic[8];
+            std::uint32_t byte_order;     // table_cache::ENDIAN_MARK
+            std::uint32_t version;
+            std::uint32_t record_size;
+            std::uint32_t reserved;
+            std::uint64_t count;
+            std::uint64_t seed;
+            std::uint8_t padding[24];
+        };
+
+        static_assert(sizeof(header) == 64, "scramble header is 64 bytes");
+
+        // Cubes are drawn in blocks of this many, each from its own seed, so
+        // a corpus comes out the same on any number of threads
+        const std::int64_t BLOCK = 4096;
+
+        // count random cubes into out, the same ones for the same seed
+        inline void generate(std::uint64_t seed, record* out, std::int64_t count)
+        {
+            thread_pool::shared().parallel_for(count, BLOCK, [seed, out](std::int64_t first, std::int64_t last)
+            {
+                random_source rng(seed ^ std::uint64_t(first / BLOCK) * 0xd1b54a32d192ed03ull);
+                rng.next();
+                for (std::int64_t i = first; i < last; i++)
+                    out[i] = pack(random_cube(rng));
+            });
+        }
+
+        // Writes a corpus file; false if it could not
+        inline bool write(const std::string& path, std::uint64_t seed, const record* records, std::uint64_t count)
+        {
+            header h = {};
+            std::memcpy(h.magic, MAGIC, 8);
+            h.byte_order = table_cache::ENDIAN_MARK;
+            h.version = VERSION;
+            h.record_size = sizeof(record);
+            h.count = count;
+            h.seed = seed;
+            std::FILE* file = std::fopen(path.c_str(), "wb");
+            if (!file)
+                return false;
+            bool ok = std::fwrite(&h, sizeof(h), 1, file) == 1
+                && (count == 0 || std::fwrite(records, sizeof(record), count, file) == count);
+            return std::fclose(file) == 0 && ok;
+        }
+
+        // A corpus file mapped read-only; empty if it is missing or not one
+        class corpus
+        {
+        public:
+            explicit corpus(const std::string& path) : data(0), length(0), records(0), count(0)
+            {
+                data = table_cache::map_file(path, length);
+                const header* h = static_cast<const header*>(data);
+                if (data && length >= sizeof(header) && std::memcmp(h->magic, MAGIC, 8) == 0
+                    && h->byte_order == table_cache::ENDIAN_MARK && h->version == VERSION
+                    && h->record_size == sizeof(record) && length == sizeof(header) + h->count * sizeof(record))
+                {
+                    records = reinterpret_cast<const record*>(h + 1);
+                    count = h->count;
+                }
+            }
+
+            ~corpus()
+            {
+                if (data)
+                    table_cache::unmap_file(data, length);
+            }
+
+            corpus(const corpus&) = delete;
+            corpus& operator=(const corpus&) = delete;
+
+            bool valid() const { return records != 0; }
+            std::uint64_t size() const { return count; }
+            std::uint64_t seed() const { return valid() ? static_cast<const header*>(data)->seed : 0; }
+            const record& operator[](std::uint64_t i) const { return records[i]; }
+            CubieCube cube(std::uint64_t i) const { return unpack(records[i]); }
+
+        private:
+            const void* data;
+            std::uint64_t length;
+            const record* records;
+            std::uint64_t count;
+        };
+    }
+}
+
+#endif
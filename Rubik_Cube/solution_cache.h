@@ -0,0 +1,289 @@
+#ifndef SOLUTION_CACHE_H
+#define SOLUTION_CACHE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cubie.h"
+#include "deadline.h"
+#include "symmetry.h"
+#include "table_cache.h"
+#include "transposition.h"
+
+// Solutions already found, for cubes that come back: demo scrambles,
+// replayed sessions, and cubes that are only a rotation or mirror image of
+// one seen before. A cube is filed under the least-hashed of its 48
+// symmetric copies, so all of them share one entry, and the moves stored
+// for that copy are turned back by the same symmetry on the way out.
+// An entry remembers the time its solve had, so an answer the deadline cut
+// short is not handed to a caller with longer to look for a better one.
+namespace solver
+{
+    // The symmetric copy S * c * S^-1 a cube is filed under, and s
+    inline CubieCube canonical_form(const CubieCube& cube, int& s)
+    {
+        CubieCube best = cube;
+        std::uint64_t best_hash = zobrist_hash(cube);
+        s = 0;
+        for (int k = 1; k < symmetry::N_SYM; k++)
+        {
+            CubieCube c = symmetry::conjugate(cube, k);
+            std::uint64_t hash = zobrist_hash(c);
+            if (hash < best_hash)
+            {
+                best = c;
+                best_hash = hash;
+                s = k;
+            }
+        }
+        return best;
+    }
+
+    // The move S * m * S^-1, for every move and symmetry
+    struct conjugate_moves
+    {
+        Move move[symmetry::N_SYM][MOVE_COUNT];
+
+        conjugate_moves()
+        {
+            for (int s = 0; s < symmetry::N_SYM; s++)
+                for (int m = 0; m < MOVE_COUNT; m++)
+                    move[s][m] = symmetry::conjugate(Move(m), s);
+        }
+
+        static const conjugate_moves& get()
+        {
+            static const conjugate_moves instance;
+            return instance;
+        }
+    };
+
+    class solution_cache
+    {
+    public:
+        struct stats
+        {
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            size_t entries = 0;
+
+            double hit_ratio() const { return hits + misses > 0 ? double(hits) / double(hits + misses) : 0; }
+        };
+
+        // Called after every lookup, outside the cache's lock
+        typedef std::function<void(bool hit, const stats&)> lookup_hook;
+
+        // Layout of the cache file
+        static const std::uint32_t VERSION = 2;
+
+        // The budget of a solve that finished before its deadline, or had none
+        static const std::uint32_t COMPLETE = 0xffffffff;
+
+        // The time a solve has left before limit, in milliseconds
+        static std::uint32_t budget_of(const deadline& limit)
+        {
+            if (!limit.limited())
+                return COMPLETE;
+            long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(limit.remaining() + std::chrono::microseconds(500)).count();
+            return std::uint32_t(std::min<long long>(ms, COMPLETE - 1));
+        }
+
+        explicit solution_cache(size_t capacity) : capacity(capacity) {}
+
+        // solutions.cache next to the solver tables
+        static std::string default_path()
+        {
+            const std::string& dir = table_cache::directory();
+            return (dir.empty() ? dir : dir + "/") + "solutions.cache";
+        }
+
+        void set_hook(lookup_hook hook)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->hook = std::move(hook);
+        }
+
+        // The moves stored for the cube, or one symmetric to it, under tag
+        // (the engine that solved it, say), if their solve had at least
+        // budget milliseconds or finished
+        bool find(const CubieCube& cube, std::uint8_t tag, MoveSequence& moves, std::uint32_t budget = COMPLETE)
+        {
+            int s;
+            CubieCube key = canonical_form(cube, s);
+            bool hit = false;
+            stats now;
+            lookup_hook call;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = index.find(entry_key(key, tag));
+                if (it != index.end() && it->second->cube == key && it->second->tag == tag && it->second->budget >= budget)
+                {
+                    // most recently used first
+                    order.splice(order.begin(), order, it->second);
+                    // the moves solve S * c * S^-1, so S^-1 * moves * S solves c
+                    const conjugate_moves& conj = conjugate_moves::get();
+                    int back = symmetry::all().inverse[s];
+                    moves.clear();
+                    for (Move m : it->second->moves)
+                        moves.push_back(conj.move[back][m]);
+                    hit = true;
+                }
+                (hit ? counts.hits : counts.misses)++;
+                counts.entries = order.size();
+                now = counts;
+                call = hook;
+            }
+            if (call)
+                call(hit, now);
+            return hit;
+        }
+
+        // Stores moves that solve the cube, found with budget milliseconds
+        // or by a solve that finished, dropping the least recently used
+        // entry when full; moves that do not solve it are ignored, and so
+        // are ones found with less time than those already stored
+        void insert(const CubieCube& cube, std::uint8_t tag, const MoveSequence& moves, std::uint32_t budget = COMPLETE)
+        {
+            CubieCube after = cube;
+            for (Move m : moves)
+                after.move(m);
+            if (!(after == CubieCube::solved()) || moves.size() > 255 || capacity == 0)
+                return;
+            int s;
+            CubieCube key = canonical_form(cube, s);
+            const conjugate_moves& conj = conjugate_moves::get();
+            MoveSequence stored;
+            for (Move m : moves)
+                stored.push_back(conj.move[s][m]);
+            std::lock_guard<std::mutex> lock(mutex);
+            add(key, tag, budget, stored);
+        }
+
+        stats statistics() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return counts;
+        }
+
+        // Entries, most recently used first, through the table cache's
+        // checked, written-then-renamed file format
+        bool save(const std::string& path) const
+        {
+            std::vector<std::uint8_t> bytes;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (const entry& e : order)
+                {
+                    const std::uint8_t* c = &e.cube.cp[0];
+                    bytes.insert(bytes.end(), c, c + sizeof(CubieCube));
+                    bytes.push_back(e.tag);
+                    const std::uint8_t* b = reinterpret_cast<const std::uint8_t*>(&e.budget);
+                    bytes.insert(bytes.end(), b, b + sizeof(e.budget));
+                    bytes.push_back(std::uint8_t(e.moves.size()));
+                    bytes.insert(bytes.end(), e.moves.begin(), e.moves.end());
+                }
+            }
+            return table_cache::store(path, VERSION, bytes.data(), bytes.size());
+        }
+
+        // Adds the entries of a file save() wrote; false if it is missing,
+        // stale or corrupt
+        bool load(const std::string& path)
+        {
+            std::FILE* file = std::fopen(path.c_str(), "rb");
+            if (!file)
+                return false;
+            std::vector<std::uint8_t> bytes;
+            std::uint8_t buffer[4096];
+            for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), file)) > 0;)
+                bytes.insert(bytes.end(), buffer, buffer + n);
+            std::fclose(file);
+            if (bytes.size() < sizeof(table_cache::header))
+                return false;
+            if (!table_cache::valid(reinterpret_cast<const table_cache::header*>(bytes.data()), VERSION, bytes.size() - sizeof(table_cache::header)))
+                return false;
+
+            std::vector<entry> entries;
+            for (size_t at = sizeof(table_cache::header); at < bytes.size();)
+            {
+                // cube, tag, budget, length, moves
+                const size_t fixed = sizeof(CubieCube) + 1 + sizeof(std::uint32_t) + 1;
+                if (bytes.size() - at < fixed || bytes.size() - at < fixed + bytes[at + fixed - 1])
+                    return false;
+                entry e;
+                std::memcpy(&e.cube, &bytes[at], sizeof(CubieCube));
+                e.tag = bytes[at + sizeof(CubieCube)];
+                std::memcpy(&e.budget, &bytes[at + sizeof(CubieCube) + 1], sizeof(e.budget));
+                size_t length = bytes[at + fixed - 1];
+                at += fixed;
+                for (size_t i = 0; i < length; i++)
+                {
+                    if (bytes[at + i] >= MOVE_COUNT)
+                        return false;
+                    e.moves.push_back(Move(bytes[at + i]));
+                }
+                at += length;
+                entries.push_back(e);
+            }
+            // oldest first, so the most recent ends up in front
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = entries.size(); i-- > 0;)
+                add(entries[i].cube, entries[i].tag, entries[i].budget, entries[i].moves);
+            return true;
+        }
+
+    private:
+        struct entry
+        {
+            CubieCube cube;
+            std::uint8_t tag;
+            std::uint32_t budget;
+            MoveSequence moves;
+        };
+
+        size_t capacity;
+        mutable std::mutex mutex;
+        std::list<entry> order;
+        std::unordered_map<std::uint64_t, std::list<entry>::iterator> index;
+        stats counts;
+        lookup_hook hook;
+
+        static std::uint64_t entry_key(const CubieCube& cube, std::uint8_t tag)
+        {
+            return zobrist_hash(cube) ^ (std::uint64_t(tag) + 1) * 0x9e3779b97f4a7c15ull;
+        }
+
+        // with the lock held
+        void add(const CubieCube& cube, std::uint8_t tag, std::uint32_t budget, const MoveSequence& moves)
+        {
+            std::uint64_t key = entry_key(cube, tag);
+            auto it = index.find(key);
+            if (it != index.end())
+            {
+                if (it->second->budget > budget)
+                    return;
+                order.erase(it->second);
+                index.erase(it);
+            }
+            else if (order.size() >= capacity)
+            {
+                index.erase(entry_key(order.back().cube, order.back().tag));
+                order.pop_back();
+            }
+            order.push_front(entry{ cube, tag, budget, moves });
+            index[key] = order.begin();
+            counts.entries = order.size();
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef SOLVE_WORKER_H
+#define SOLVE_WORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "solver.h"
+
+// Solving away from the render loop: a thread of its own takes cubes, solves
+// them one after another and hands the moves back through a channel the
+// render loop polls once a frame without ever blocking on it.
+namespace solver
+{
+    // Values passed from one thread to another, first in first out
+    template <typename T>
+    class channel
+    {
+    public:
+        void push(T value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            values.push_back(std::move(value));
+        }
+
+        // Takes the oldest value, if there is one
+        bool try_pop(T& value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (values.empty())
+                return false;
+            value = std::move(values.front());
+            values.pop_front();
+            return true;
+        }
+
+    private:
+        std::mutex mutex;
+        std::deque<T> values;
+    };
+
+    class solve_worker
+    {
+    public:
+        // Solutions kept across runs, in solution_cache::default_path()
+        static const size_t CACHE_ENTRIES = 4096;
+
+        solve_worker() : cache(CACHE_ENTRIES), thread([this] { work(); }) { cache.load(solution_cache::default_path()); }
+
+        // Cancels the solve under way, drops the queued ones and writes the
+        // cache back
+        ~solve_worker()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            token.cancel();
+            job_ready.notify_all();
+            thread.join();
+            cache.save(solution_cache::default_path());
+        }
+
+        solve_worker(const solve_worker&) = delete;
+        solve_worker& operator=(const solve_worker&) = delete;
+
+        // A solution, with the number request() gave its cube
+        struct result
+        {
+            std::uint64_t id;
+            MoveSequence moves;
+        };
+
+        // Queues a cube and returns its number, counting up from 1; its
+        // solution, the best found within budget from when its solve
+        // starts, goes to results() and, with export_file, to result.txt
+        // as well. A caller that only wants the latest cube drops results
+        // with older numbers.
+        std::uint64_t request(const CubeState& state, engine method, deadline::clock::duration budget, bool export_file = false)
+        {
+            pending++;
+            std::uint64_t id;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                id = ++last_id;
+                jobs.push_back(job{ id, state, method, budget, export_file });
+            }
+            job_ready.notify_one();
+            return id;
+        }
+
+        channel<result>& results() { return solved; }
+
+        // Repeated cubes are answered from here; set_hook() on it to watch
+        // the hit ratio
+        solution_cache& solutions() { return cache; }
+
+        // Requests whose solution is not in results() yet
+        bool busy() const { return pending.load() > 0; }
+
+    private:
+        struct job
+        {
+            std::uint64_t id;
+            CubeState state;
+            engine method;
+            deadline::clock::duration budget;
+            bool export_file;
+        };
+
+        std::mutex mutex;
+        std::condition_variable job_ready;
+        std::deque<job> jobs;
+        std::uint64_t last_id = 0;
+        bool stopping = false;
+        cancel_token token;
+        std::atomic<int> pending{ 0 };
+        channel<result> solved;
+        solution_cache cache;
+        std::thread thread;
+
+        void work()
+        {
+            for (;;)
+            {
+                job next;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    job_ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+                    if (stopping)
+                        return;
+                    next = jobs.front();
+                    jobs.pop_front();
+                }
+                MoveSequence moves = solve(next.state, deadline(next.budget, token), next.method, cache);
+                if (next.export_file)
+                    write_result(moves);
+                // pushed before it stops counting as pending, so busy() never
+                // reports idle with a solution still on its way
+                solved.push(result{ next.id, moves });
+                pending--;
+            }
+        }
+    };
+}
+
+#endif
@@ -1,352 +1,90 @@
 #include<iostream>
 #include<fstream>
+#include<cstring>
+#include<chrono>
+#include<span>
+#include "cube_state.h"
+#include "deadline.h"
+#include "facelet_move.h"
+#include "two_phase.h"
+#include "optimal.h"
+#include "thistlethwaite.h"
+#include "meet_in_middle.h"
+#include "cfop.h"
+#include "solution_cache.h"
 using namespace std;
-char sol[150],sol2[150];
-int x=0,k,z,p,q,v;
-char w[100][100],o[100][100],g[100][100],re[100][100],b[100][100],y[100][100];
-void swap(char &a,char &b)
+namespace solver
 {
-	char c;
-	c=a;
-	a=b;
-	b=c;
+    // Everything one layer-by-layer solve works on: its own copy of the cube,
+    // the raw move buffers and the scratch counters the passes below share.
+    // Each solve() builds a fresh one, so solves never see each other.
+    struct layer_solver
+    {
+        CubeState cube;
+        char (&w)[3][3],(&o)[3][3],(&g)[3][3],(&re)[3][3],(&b)[3][3],(&y)[3][3];
+        static const int MAX_MOVES=8192;
+        char sol[MAX_MOVES+4]={};
+        int x=0,k=0,z=0,p=0,q=0,v=0;
+
+        layer_solver(const CubeState& state)
+            : cube(by_centres(state)),
+              w(cube.face[WHITE]),o(cube.face[ORANGE]),g(cube.face[GREEN]),
+              re(cube.face[RED]),b(cube.face[BLUE]),y(cube.face[YELLOW])
+        {
+        }
+        // The passes test for the letters of CubeState::solved on fixed
+        // faces, so every sticker is renamed after the face whose centre
+        // has its colour, as to_cubie_cube() reads them; a cube left turned
+        // by slice moves then solves like any other
+        static CubeState by_centres(const CubeState& state)
+        {
+            const char colours[]="WOGRBY";
+            char letter[256]={};
+            for(int f=0;f<6;f++)
+                letter[(unsigned char)state.face[f][1][1]]=colours[f];
+            CubeState named=state;
+            for(int f=0;f<6;f++)
+                for(int i=0;i<3;i++)
+                    for(int j=0;j<3;j++)
+                        named.face[f][i][j]=letter[(unsigned char)state.face[f][i][j]];
+            return named;
+        }
+        void rot(char r);
+        MoveSequence run();
+    };
 }
-void rot(char r)
+// The quarter turn a letter of sol stands for, upper case clockwise
+static solver::Move letter_move(char r)
 {
-	if(r=='R')
-	{
-		swap(w[2][2],re[0][0]);
-		swap(w[0][2],re[2][0]);
-		swap(w[2][2],y[2][2]);
-		swap(w[0][2],y[0][2]);
-		swap(w[2][2],o[2][2]);
-		swap(w[0][2],o[0][2]);
-		swap(g[0][0],g[0][2]);
-		swap(g[0][0],g[2][2]);
-		swap(g[0][0],g[2][0]);
-		
-		swap(w[1][2],re[1][0]);
-		swap(w[1][2],y[1][2]);
-		swap(w[1][2],o[1][2]);
-		swap(g[0][1],g[1][2]);
-		swap(g[0][1],g[2][1]);
-		swap(g[0][1],g[1][0]);
-		sol[x++]='R';
-	}
-	else if(r=='r')
-	{
-		swap(w[2][2],o[2][2]);
-		swap(w[0][2],o[0][2]);
-		swap(w[2][2],y[2][2]);
-		swap(w[0][2],y[0][2]);
-		swap(w[2][2],re[0][0]);
-		swap(w[0][2],re[2][0]);
-		swap(g[0][0],g[2][0]);
-		swap(g[0][0],g[2][2]);
-		swap(g[0][0],g[0][2]);
-		
-		swap(w[1][2],o[1][2]);
-		swap(w[1][2],y[1][2]);
-		swap(w[1][2],re[1][0]);
-		swap(g[0][1],g[1][0]);
-		swap(g[0][1],g[2][1]);
-		swap(g[0][1],g[1][2]);
-		sol[x++]='r';
-	}
-	else if(r=='L')
-	{
-		swap(w[0][0],o[0][0]);
-		swap(w[2][0],o[2][0]);
-		swap(w[0][0],y[0][0]);
-		swap(w[2][0],y[2][0]);
-		swap(w[0][0],re[2][2]);
-		swap(w[2][0],re[0][2]);
-		swap(b[0][0],b[0][2]);
-		swap(b[0][0],b[2][2]);
-		swap(b[0][0],b[2][0]);
-		
-		swap(w[1][0],o[1][0]);
-		swap(w[1][0],y[1][0]);
-		swap(w[1][0],re[1][2]);
-		swap(b[0][1],b[1][2]);
-		swap(b[0][1],b[2][1]);
-		swap(b[0][1],b[1][0]);
-		sol[x++]='L';
-	}
-	else if(r=='l')
-	{
-		swap(w[0][0],re[2][2]);
-		swap(w[2][0],re[0][2]);
-		swap(w[0][0],y[0][0]);
-		swap(w[2][0],y[2][0]);
-		swap(w[0][0],o[0][0]);
-		swap(w[2][0],o[2][0]);
-		swap(b[0][0],b[0][2]);
-		swap(b[0][2],b[2][0]);
-		swap(b[2][2],b[0][2]);
-		
-		swap(w[1][0],re[1][2]);
-		swap(w[1][0],y[1][0]);
-		swap(w[1][0],o[1][0]);
-		swap(b[0][1],b[1][0]);
-		swap(b[0][1],b[2][1]);
-		swap(b[0][1],b[1][2]);
-		sol[x++]='l';
-	}
-	else if(r=='U')
-	{
-		swap(o[0][0],b[0][0]);
-		swap(o[0][2],b[0][2]);
-		swap(o[0][0],re[0][0]);
-		swap(o[0][2],re[0][2]);
-		swap(o[0][0],g[0][0]);
-		swap(o[0][2],g[0][2]);
-		swap(w[0][0],w[0][2]);
-		swap(w[0][0],w[2][2]);
-		swap(w[0][0],w[2][0]);
-		
-		swap(o[0][1],b[0][1]);
-		swap(o[0][1],re[0][1]);
-		swap(o[0][1],g[0][1]);
-		swap(w[2][1],w[1][0]);
-		swap(w[2][1],w[0][1]);
-		swap(w[2][1],w[1][2]);
-		sol[x++]='U';
-	}
-	else if(r=='u')
-	{
-		swap(o[0][0],g[0][0]);
-		swap(o[0][2],g[0][2]);
-		swap(o[0][0],re[0][0]);
-		swap(o[0][2],re[0][2]);
-		swap(o[0][0],b[0][0]);
-		swap(o[0][2],b[0][2]);
-		swap(w[0][0],w[2][0]);
-		swap(w[0][0],w[2][2]);
-		swap(w[0][0],w[0][2]);
-		
-		swap(o[0][1],g[0][1]);
-		swap(o[0][1],re[0][1]);
-	    swap(o[0][1],b[0][1]);
-		swap(w[2][1],w[1][2]);
-		swap(w[2][1],w[0][1]);
-		swap(w[2][1],w[1][0]);
-		sol[x++]='u';
-	}
-	else if(r=='D')
-	{
-		swap(o[2][2],g[2][2]);
-		swap(o[2][0],g[2][0]);
-		swap(o[2][2],re[2][2]);
-		swap(o[2][0],re[2][0]);
-		swap(o[2][2],b[2][2]);
-		swap(o[2][0],b[2][0]);
-		swap(y[0][0],y[0][2]);
-		swap(y[0][0],y[2][2]);
-		swap(y[0][0],y[2][0]);
-		
-		swap(o[2][1],g[2][1]);
-		swap(o[2][1],re[2][1]);
-		swap(o[2][1],b[2][1]);
-		swap(y[0][1],y[1][2]);
-		swap(y[0][1],y[2][1]);
-		swap(y[0][1],y[1][0]);
-		sol[x++]='D';
-	}
-	else if(r=='d')
-	{
-		swap(o[2][2],b[2][2]);
-		swap(o[2][0],b[2][0]);
-		swap(o[2][2],re[2][2]);
-		swap(o[2][0],re[2][0]);
-		swap(o[2][2],g[2][2]);
-		swap(o[2][0],g[2][0]);
-		swap(y[0][0],y[2][0]);
-		swap(y[0][0],y[2][2]);
-		swap(y[0][0],y[0][2]);
-		
-		swap(o[2][1],b[2][1]);
-		swap(o[2][1],re[2][1]);
-		swap(o[2][1],g[2][1]);
-		swap(y[0][1],y[1][0]);
-		swap(y[0][1],y[2][1]);
-		swap(y[0][1],y[1][2]);
-		sol[x++]='d';
-	}
-	else if(r=='F')
-	{
-		swap(w[2][2],g[2][0]);
-		swap(w[2][0],g[0][0]);
-		swap(w[2][2],y[0][0]);
-		swap(w[2][0],y[0][2]);
-		swap(w[2][2],b[0][2]);
-		swap(w[2][0],b[2][2]);
-		swap(o[0][0],o[0][2]);
-		swap(o[0][0],o[2][2]);
-		swap(o[0][0],o[2][0]);
-		
-		swap(w[2][1],g[1][0]);
-		swap(w[2][1],y[0][1]);
-		swap(w[2][1],b[1][2]);
-		swap(o[0][1],o[1][2]);
-		swap(o[0][1],o[2][1]);
-		swap(o[0][1],o[1][0]);
-		sol[x++]='F';
-	}
-	else if(r=='f')
+	static const struct letters
 	{
-		swap(w[2][2],b[0][2]);
-		swap(w[2][0],b[2][2]);
-		swap(w[2][2],y[0][0]);
-		swap(w[2][0],y[0][2]);
-		swap(w[2][2],g[2][0]);
-		swap(w[2][0],g[0][0]);
-		swap(o[0][0],o[2][0]);
-		swap(o[0][0],o[2][2]);
-		swap(o[0][0],o[0][2]);
-		
-		swap(w[2][1],b[1][2]);
-		swap(w[2][1],y[0][1]);
-		swap(w[2][1],g[1][0]);
-		swap(o[0][1],o[1][0]);
-		swap(o[0][1],o[2][1]);
-		swap(o[0][1],o[1][2]);
-		sol[x++]='f';
-	}
-	else if(r=='B')
-	{
-		swap(w[0][0],b[2][0]);
-		swap(w[0][2],b[0][0]);
-		swap(w[0][0],y[2][2]);
-		swap(w[0][2],y[2][0]);
-		swap(w[0][0],g[0][2]);
-		swap(w[0][2],g[2][2]);
-		swap(re[0][0],re[0][2]);
-		swap(re[0][0],re[2][2]);
-		swap(re[0][0],re[2][0]);
-		
-		swap(w[0][1],b[1][0]);
-		swap(w[0][1],y[2][1]);
-		swap(w[0][1],g[1][2]);
-		swap(re[0][1],re[1][2]);
-		swap(re[0][1],re[2][1]);
-		swap(re[0][1],re[1][0]);
-		sol[x++]='B';
-	}	
-	else if(r=='b')
-	{
-		swap(w[0][0],g[0][2]);
-		swap(w[0][2],g[2][2]);
-		swap(w[0][0],y[2][2]);
-		swap(w[0][2],y[2][0]);
-		swap(w[0][0],b[2][0]);
-		swap(w[0][2],b[0][0]);
-		swap(re[0][0],re[2][0]);
-		swap(re[0][0],re[2][2]);
-		swap(re[0][0],re[0][2]);
-		
-		swap(w[0][1],g[1][2]);
-		swap(w[0][1],y[2][1]);
-		swap(w[0][1],b[1][0]);
-		swap(re[0][1],re[1][0]);
-		swap(re[0][1],re[2][1]);
-		swap(re[0][1],re[1][2]);
-		sol[x++]='b';
-	}
+		solver::Move move[128];
+		letters()
+		{
+			const char names[]="URFDLB";
+			for(int f=0;f<6;f++)
+			{
+				move[int(names[f])]=solver::make_move(f,1);
+				move[int(names[f])+32]=solver::make_move(f,3);
+			}
+		}
+	} table;
+	return table.move[r&127];
 }
 
-namespace solver 
+// A quarter turn, recorded for the solution
+void solver::layer_solver::rot(char r)
 {
-    void solve()
+	apply_move(cube,letter_move(r));
+	if(x<MAX_MOVES)
+		sol[x++]=r;
+}
+
+namespace solver
+{
+    MoveSequence layer_solver::run()
     {
-        // read from file data.txt
-        ifstream data("data.txt");
-        int i,j;
-        // cout<<"Enter the colours of white centered face in matrix order keeping red centered face as top:"<<endl;
-        for(i=0;i<3;i++)
-        {
-    	    for(j=0;j<3;j++)
-    	        // cin>>w[i][j];
-                data>>w[i][j];
-	    }
-	    // cout<<endl<<endl;
-	    // for(i=0;i<3;i++)
-        // {
-        // 	for(j=0;j<3;j++)
-        // 	    cout<<w[i][j]<<"\t";
-        // 	cout<<endl<<endl;
-	    // }
-	    // cout<<"Enter the colours of orange centered face in matrix order keeping white centered face as top:"<<endl;
-	    for(i=0;i<3;i++)
-        {
-    	    for(j=0;j<3;j++)
-    	        // cin>>o[i][j];
-                data>>o[i][j];
-	    }
-	    // cout<<endl<<endl;
-	    // for(i=0;i<3;i++)
-        // {
-        // 	for(j=0;j<3;j++)
-        // 	    cout<<o[i][j]<<"\t";
-        // 	cout<<endl<<endl;
-	    // }
-	    // cout<<"Enter the colours of green centered face in matrix order keeping white centered face as top:"<<endl;
-	    for(i=0;i<3;i++)
-        {
-    	    for(j=0;j<3;j++)
-    	        // cin>>g[i][j];
-                data>>g[i][j];
-	    }
-	    // cout<<endl<<endl;
-	    // for(i=0;i<3;i++)
-        // {
-        // 	for(j=0;j<3;j++)
-        // 	    cout<<g[i][j]<<"\t";
-        // 	cout<<endl<<endl;
-	    // }
-	    // cout<<"Enter the colours of red centered face in matrix order keeping white centered face as top:"<<endl;
-	    for(i=0;i<3;i++)
-        {
-    	    for(j=0;j<3;j++)
-    	        // cin>>re[i][j];
-                data>>re[i][j];
-	    }
-	    // cout<<endl<<endl;
-	    // for(i=0;i<3;i++)
-        // {
-        // 	for(j=0;j<3;j++)
-        // 	    cout<<re[i][j]<<"\t";
-        // 	cout<<endl<<endl;
-	    // }
-	    // cout<<"Enter the colours of blue centered face in matrix order keeping white centered face as top:"<<endl;
-	    for(i=0;i<3;i++)
-        {
-    	    for(j=0;j<3;j++)
-    	        // cin>>b[i][j];
-                data>>b[i][j];
-	    }
-	    // cout<<endl<<endl;
-	    // for(i=0;i<3;i++)
-        // {
-        // 	for(j=0;j<3;j++)
-        // 	    cout<<b[i][j]<<"\t";
-        // 	cout<<endl<<endl;
-	    // }
-	    // cout<<"Enter the colours of yellow centered face in matrix order keeping orange centered face as top:"<<endl;
-	    for(i=0;i<3;i++)
-        {
-    	    for(j=0;j<3;j++)
-    	        // cin>>y[i][j];
-                data>>y[i][j];
-	    }
-	    // cout<<endl<<endl;
-	    // for(i=0;i<3;i++)
-        // {
-        // 	for(j=0;j<3;j++)
-        // 	    cout<<y[i][j]<<"\t";
-        // 	cout<<endl<<endl;
-	    // }
-	    cout<<endl<<endl;//input is taken
+        int i;
 	    // cout<<"Apply this algorithm keeping the white centered face as top and orange centered face as front :"<<endl<<endl;
 	    k=100;
 	    for(i=0;i<k;i++)// white layer solving
@@ -15402,266 +15140,224 @@ namespace solver
     }
 
 
-    for(v=0;v<10;v++)//REDUCTION OF USELESS MOVES
+        // every letter a quarter turn, lower case counterclockwise
+        MoveSequence moves;
+        for(p=0;sol[p]!='\0';p++)
+        {
+            char c=sol[p];
+            int face=int(strchr("URFDLB",c>=97?c-32:c)-"URFDLB");
+            moves.push_back(make_move(face,c>=97?3:1));
+        }
+        return simplify(moves);
+    }
+
+    // Which algorithm solve() uses
+    enum class engine
     {
-	    for(k=0;k<10;k++)
-	    {
-	    for(p=0,z=0;sol[p]!='\0';p++,z++)
-	    {
-		    if((sol[p]+32)==sol[p+1]||(sol[p+1]+32)==sol[p])
-		    p+=2;
-		    sol2[z]=sol[p];
-	    }
-	    sol2[z]='\0';
-	    for(p=0,z=0;sol2[p]!='\0';p++,z++)
-	    {
-		    sol[z]=sol2[p];
-	    }
-	    sol[z]='\0';
-	    }
-	    for(p=0,z=0;sol2[p]!='\0';p++,z++)
-	    {
-		    sol[z]=sol2[p];
-	    }
-	    sol[z]='\0';
-	    for(k=0;k<10;k++)
-	    {
-	    for(p=0,z=0;sol[p]!='\0';p++,z++)
-	    {
-		    if(sol[p]==sol[p+1]&&sol[p+1]==sol[p+2]&&sol[p+2]==sol[p+3])
-		    p+=4;
-		    sol2[z]=sol[p];
-	    }
-	    sol2[z]='\0';
-	    for(p=0,z=0;sol2[p]!='\0';p++,z++)
-	    {
-		    sol[z]=sol2[p];
-	    }
-	    sol[z]='\0';
-	    }
-	    for(p=0,z=0;sol2[p]!='\0';p++,z++)
-	    {
-		    sol[z]=sol2[p];
-	    }
-	    sol[z]='\0';
-	    for(k=0;k<10;k++)
-	    {
-		    for(p=0,z=0;sol[p]!='\0';p++,z++)
-		    {
-			    if(sol[p]==sol[p+1]&&sol[p+1]==sol[p+2]&&sol[p+2]!=sol[p+3])
-			    {
-			 	    if(sol[p]>=97)
-		 		    sol2[z]=sol[p]-32;
-		 		    else
-		 		    sol2[z]=sol[p]+32;
-		  	     p+=2;
-	    	    }
-			    else
-			    sol2[z]=sol[p];
-		    }
-		    sol2[z]='\0';
-		    for(p=0,z=0;sol2[p]!='\0';p++,z++)
-		    {
-			    sol[z]=sol2[p];
-		    }
-		    sol[z]='\0';
-	    }
-	    for(p=0,z=0;sol2[p]!='\0';p++,z++)
-	    {
-		    sol[z]=sol2[p];
-	    }
-	    sol[z]='\0';
-	    for(k=0;k<10;k++)
-	    {
-	    for(p=0,z=0;sol[p]!='\0';p++,z++)
-	    {
-			    if(sol[p]==sol[p+2]||sol[p]==(sol[p+2]+32)||sol[p]==(sol[p+2]-32))
-			    {
-			 	    if((sol[p]=='L'||sol[p]=='l')&&(sol[p+1]=='R'||sol[p+1]=='r'))
-			 	    {
-			 		    sol2[z]=sol[p+1];
-			 		    sol2[z+1]=sol[p];
-			 		    p++;
-					    z++;
-				    }
-				    else if((sol[p]=='R'||sol[p]=='r')&&(sol[p+1]=='L'||sol[p+1]=='l'))
-			 	    {
-			 		    sol2[z]=sol[p+1];
-			 		    sol2[z+1]=sol[p];
-			 		    p++;
-					    z++;
-				    }
-				    else if((sol[p]=='U'||sol[p]=='u')&&(sol[p+1]=='D'||sol[p+1]=='d'))
-			 	    {
-			 		    sol2[z]=sol[p+1];
-			 		    sol2[z+1]=sol[p];
-			 		    p++;
-					    z++;
-				    }
-				    else if((sol[p]=='D'||sol[p]=='d')&&(sol[p+1]=='U'||sol[p+1]=='u'))
-			 	    {
-			 		    sol2[z]=sol[p+1];
-			 		    sol2[z+1]=sol[p];
-			 		    p++;
-					    z++;
-				    }
-				    else if((sol[p]=='F'||sol[p]=='f')&&(sol[p+1]=='B'||sol[p+1]=='b'))
-			 	    {
-			 		    sol2[z]=sol[p+1];
-			 		    sol2[z+1]=sol[p];
-			 		    p++;
-					    z++;
-				    }
-				    else if((sol[p]=='B'||sol[p]=='b')&&(sol[p+1]=='F'||sol[p+1]=='f'))
-			 	    {
-			 		    sol2[z]=sol[p+1];
-			 		    sol2[z+1]=sol[p];
-			 		    p++;
-					    z++;
-				    }
-				    else
-			        sol2[z]=sol[p];
-	    	    }
-			    else
-			    sol2[z]=sol[p];
-	    }
-	    sol2[z]='\0';
-	    for(p=0,z=0;sol2[p]!='\0';p++,z++)
-	    {
-		    sol[z]=sol2[p];
-	    }
-	    sol[z]='\0';
-	    }
+        layer_by_layer, // the passes above, 100+ moves, no tables
+        two_phase,      // Kociemba, at most 22 moves
+        thistlethwaite, // four table walks, about 31 moves; under 1 MB of tables
+        optimal,        // Korf, shortest possible; 130 MB of tables, slow on deep cubes
+        cfop            // cross, F2L, OLL, PLL, about 52 moves a viewer can follow; 1.4 MB of tables
+    };
+    // two_phase and optimal answer cubes within meet_in_middle::DEPTH +
+    // FORWARD moves of solved from its 8 MB table, optimally, before searching
+
+    // Solves one cube. No state is shared between calls, so solves can run
+    // concurrently on as many threads as needed. A cube check_cube() finds
+    // impossible gets no moves and no search. The layer-by-layer passes are
+    // the fallback whenever the chosen engine cannot handle the cube.
+    MoveSequence solve(const CubeState& state, engine method = engine::two_phase)
+    {
+        CubieCube cube;
+        if (!to_cubie_cube(state, cube))
+            return MoveSequence();
+        MoveSequence moves;
+        if (method == engine::two_phase || method == engine::optimal)
+        {
+            // a cube a few moves out gets its optimal solution in microseconds
+            if (meet_in_middle::solve(cube, meet_in_middle::FORWARD, moves))
+                return moves;
+        }
+        if (method == engine::two_phase)
+        {
+            if (two_phase::solve(cube, 22, moves))
+                return moves;
+        }
+        else if (method == engine::thistlethwaite)
+        {
+            // the phases can meet on turns of one face
+            if (thistlethwaite::solve(cube, moves))
+                return simplify(moves);
+        }
+        else if (method == engine::optimal)
+        {
+            vector<MoveSequence> solutions = optimal::solve(cube, false);
+            if (!solutions.empty())
+                return solutions[0];
+        }
+        else if (method == engine::cfop)
+        {
+            if (cfop::solve(cube, moves))
+                return moves;
+        }
+        layer_solver s(state);
+        return s.run();
     }
 
+    // Solves one cube by a deadline, returning the best found by then:
+    // two-phase keeps looking for shorter solutions while time remains;
+    // optimal gives two-phase most of the time and IDA* the rest to look for
+    // something shorter, answering with the two-phase solution otherwise.
+    // A cube two-phase has no answer for yet gets a Thistlethwaite one,
+    // which takes well under a millisecond.
+    MoveSequence solve(const CubeState& state, const deadline& limit, engine method = engine::two_phase)
+    {
+        CubieCube cube;
+        if (!to_cubie_cube(state, cube))
+            return MoveSequence();
+        MoveSequence moves;
+        if (method == engine::layer_by_layer || method == engine::thistlethwaite || method == engine::cfop)
+            return solve(state, method);
+        if (meet_in_middle::solve(cube, meet_in_middle::FORWARD, moves))
+            return moves;
+        if (method == engine::optimal)
+        {
+            // without a time limit IDA* will finish, so two-phase's first
+            // solution is only a fallback
+            if (limit.limited())
+                two_phase::solve(cube, 22, limit.part(0.8), moves);
+            else
+                two_phase::solve(cube, 22, moves);
+            // only a shorter solution is worth the search; none at all
+            // proves the two-phase one optimal
+            vector<MoveSequence> solutions = optimal::solve(cube, limit, moves.empty() ? 20 : int(moves.size()) - 1);
+            if (!solutions.empty())
+                return solutions[0];
+            if (!moves.empty() || cube == CubieCube::solved())
+                return moves;
+        }
+        else if (two_phase::solve(cube, 22, limit, moves))
+            return moves;
+        return solve(state, engine::thistlethwaite);
+    }
 
-    // write result to result.txt
-    ofstream outfile;
-    outfile.open("result.txt", std::ios::trunc);
+    // The same through a cache of earlier solutions: a cube seen before,
+    // or a rotation or mirror image of one, is answered from the cache.
+    // A solve the deadline cut short is filed with the time it had, so a
+    // caller with longer solves again; a cancelled one is not filed.
+    MoveSequence solve(const CubeState& state, const deadline& limit, engine method, solution_cache& cache)
+    {
+        CubieCube cube;
+        if (!to_cubie_cube(state, cube))
+            return MoveSequence();
+        MoveSequence moves;
+        std::uint32_t budget = solution_cache::budget_of(limit);
+        if (cache.find(cube, std::uint8_t(method), moves, budget))
+            return moves;
+        moves = solve(state, limit, method);
+        if (!limit.cancelled())
+            cache.insert(cube, std::uint8_t(method), moves, limit.expired() ? budget : solution_cache::COMPLETE);
+        return moves;
+    }
 
+    // Every shortest solution of a cube, all of the same length
+    vector<MoveSequence> solve_all_optimal(const CubeState& state)
+    {
+        CubieCube cube;
+        if (!to_cubie_cube(state, cube))
+            return vector<MoveSequence>();
+        return optimal::solve(cube, true);
+    }
 
-    for(p=0;sol2[p]!='\0';p++)
-	    {
-		    if(sol2[p]==sol2[p+1]&&(sol2[p+1]=='R'||sol2[p+1]=='r'))
-		    {
-		    cout<<"R2 ";
-            outfile<<"R2 ";
-		    p++;
-		    }
-		    else if(sol2[p]==sol2[p+1]&&(sol2[p+1]=='L'||sol2[p+1]=='l'))
-		    {
-		    cout<<"L2 ";
-            outfile<<"L2 ";
-		    p++;
-		    }
-		    else if(sol2[p]==sol2[p+1]&&(sol2[p+1]=='F'||sol2[p+1]=='f'))
-		    {
-		    cout<<"F2 ";
-            outfile<<"F2 ";
-		    p++;
-		    }
-		    else if(sol2[p]==sol2[p+1]&&(sol2[p+1]=='B'||sol2[p+1]=='b'))
-		    {
-		    cout<<"B2 ";
-            outfile<<"B2 ";
-		    p++;
-		    }
-		    else if(sol2[p]==sol2[p+1]&&(sol2[p+1]=='D'||sol2[p+1]=='d'))
-		    {
-		    cout<<"D2 ";
-            outfile<<"D2 ";
-		    p++;
-		    }
-		    else if(sol2[p]==sol2[p+1]&&(sol2[p+1]=='U'||sol2[p+1]=='u'))
-		    {
-		    cout<<"U2 ";
-            outfile<<"U2 ";
-		    p++;
-		    }
-		    else if(sol2[p]!=sol2[p+1]&&sol2[p]=='r')
-            {
-		    cout<<"R' ";
-            outfile<<"R' ";
-            }
-		    else if(sol2[p]!=sol2[p+1]&&sol2[p]=='l')
-		    {
-            cout<<"L' ";
-            outfile<<"L' ";
-            }
-		    else if(sol2[p]!=sol2[p+1]&&sol2[p]=='f')
-            {
-		    cout<<"F' ";
-            outfile<<"F' ";
-            }
-		    else if(sol2[p]!=sol2[p+1]&&sol2[p]=='b')
-            {
-		    cout<<"B' ";
-            outfile<<"B' ";
-            }
-		    else if(sol2[p]!=sol2[p+1]&&sol2[p]=='d')
-            {
-		    cout<<"D' ";
-            outfile<<"D' ";
-            }
-		    else if(sol2[p]!=sol2[p+1]&&sol2[p]=='u')
-            {
-		    cout<<"U' ";
-            outfile<<"U' ";
-            }
-		    else 
-            {
-		    cout<<sol2[p]<<" ";
-            outfile<<sol2[p]<<" ";
-            }
-        }
-        int u=p;
-	    for(i=0;i<=(u-1);i++)
+    // What one solve_batch() call did
+    struct batch_stats
+    {
+        size_t solved = 0;
+        double seconds = 0;
+        double solves_per_second = 0;
+    };
+
+    // Solves cubes[i] into solutions[i] for as many cubes as there are
+    // solutions, spread over the shared thread pool a cube at a time, so a
+    // slow cube never holds up others queued behind it on the same thread
+    template <typename Solve>
+    batch_stats solve_each(span<const CubeState> cubes, span<MoveSequence> solutions, Solve solve_one)
+    {
+        batch_stats stats;
+        stats.solved = cubes.size() < solutions.size() ? cubes.size() : solutions.size();
+        auto start = chrono::steady_clock::now();
+        thread_pool::shared().parallel_for(std::int64_t(stats.solved), 1, [&](std::int64_t first, std::int64_t last)
         {
-            if(sol2[i]==sol2[i+1])
+            for (std::int64_t i = first; i < last; i++)
+                solutions[i] = solve_one(cubes[i]);
+        });
+        stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (stats.seconds > 0)
+            stats.solves_per_second = stats.solved / stats.seconds;
+        return stats;
+    }
+
+    batch_stats solve_batch(span<const CubeState> cubes, span<MoveSequence> solutions, engine method = engine::two_phase)
+    {
+        return solve_each(cubes, solutions, [method](const CubeState& state) { return solve(state, method); });
+    }
+
+    // The same with a time budget per cube, from when its solve starts;
+    // cancelling the token stops every solve of the batch
+    batch_stats solve_batch(span<const CubeState> cubes, span<MoveSequence> solutions, deadline::clock::duration budget,
+        cancel_token token = cancel_token(), engine method = engine::two_phase)
+    {
+        return solve_each(cubes, solutions, [=](const CubeState& state) { return solve(state, deadline(budget, token), method); });
+    }
+
+    // The cube in data.txt
+    CubeState read_data()
+    {
+        ifstream data("data.txt");
+        CubeState state;
+        for(int f=0;f<6;f++)
+            for(int i=0;i<3;i++)
+                for(int j=0;j<3;j++)
+                    data>>state.face[f][i][j];
+        return state;
+    }
+
+    // Writes the cube to data.txt the way read_data() takes it back
+    void write_data(const CubeState& state)
+    {
+        ofstream data("data.txt", std::ios::trunc);
+        for(int f=0;f<6;f++)
+            for(int i=0;i<3;i++)
             {
-             p--;
-             i++;
+                for(int j=0;j<3;j++)
+                    data<<state.face[f][i][j];
+                data<<"\n";
             }
+    }
+
+    // Writes the moves to cout and result.txt
+    void write_result(const MoveSequence& moves)
+    {
+        ofstream outfile;
+        outfile.open("result.txt", std::ios::trunc);
+        for(size_t i=0;i<moves.size();i++)
+        {
+            cout<<move_name(moves[i])<<" ";
+            outfile<<move_name(moves[i])<<" ";
         }
+    }
 
-        //cout<<endl<<endl<<"Number of moves:"<<p<<endl;
-        //cout<<endl<<endl;
-	    // for(i=0;i<3;i++)
-        // {
-        // 	for(j=0;j<3;j++)
-        // 	cout<<w[i][j];
-        // 	cout<<endl;
-	    // }
-	    // 	for(i=0;i<3;i++)
-        // {
-        // 	for(j=0;j<3;j++)
-        // 	cout<<o[i][j];
-        // 	cout<<endl;
-	    // }
-	    // 	for(i=0;i<3;i++)
-        // {
-        // 	for(j=0;j<3;j++)
-        // 	cout<<g[i][j];
-        // 	cout<<endl;
-	    // }
-	    // 	for(i=0;i<3;i++)
-        // {
-        // 	for(j=0;j<3;j++)
-        // 	cout<<re[i][j];
-        // 	cout<<endl;
-	    // }
-	    // 	for(i=0;i<3;i++)
-        // {
-        // 	for(j=0;j<3;j++)
-        // 	cout<<b[i][j];
-        // 	cout<<endl;
-	    // }
-	    // 	for(i=0;i<3;i++)
-        // {
-        // 	for(j=0;j<3;j++)
-        // 	cout<<y[i][j];
-        // 	cout<<endl;
-	    // }
+    // Reads the cube from data.txt and writes the moves to result.txt, the
+    // file round trip Rubik::export_files leaves behind for debugging
+    void solve(engine method = engine::two_phase)
+    {
+        write_result(solve(read_data(),method));
+    }
 
+    // The same, with the best solution found by the deadline
+    void solve(engine method, const deadline& limit)
+    {
+        write_result(solve(read_data(),limit,method));
     }
-}
\ No newline at end of file
+}
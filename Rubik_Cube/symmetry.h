@@ -0,0 +1,238 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "cubie.h"
+#include "table_cache.h"
+
+// The 48 symmetries of the cube as cubie cubes, and the tables that fold a
+// coordinate onto its class under the first 16 of them, the ones that keep
+// the U and D faces on the UD axis. Conjugating a cube by a symmetry maps
+// face turns to face turns (mirrors turn them the other way), so every
+// state of a class is equally far from solved and a pruning table needs
+// only one entry per class.
+namespace solver
+{
+    namespace symmetry
+    {
+        const int N_SYM = 48;
+        const int N_SYM_UD = 16;
+        const int N_CORNER_CLASSES = 2768;
+
+        // a * b for cubes that may be mirrored: a mirrored corner carries
+        // its twist as 3..5
+        inline CubieCube multiply(const CubieCube& a, const CubieCube& b)
+        {
+            CubieCube r;
+            for (int i = 0; i < 8; i++)
+            {
+                int oa = a.co[b.cp[i]], ob = b.co[i], o;
+                r.cp[i] = a.cp[b.cp[i]];
+                if (oa < 3 && ob < 3)
+                    o = (oa + ob) % 3;
+                else if (oa < 3)
+                    o = oa + ob >= 6 ? oa + ob - 3 : oa + ob;
+                else if (ob < 3)
+                    o = oa - ob < 3 ? oa - ob + 3 : oa - ob;
+                else
+                    o = oa - ob < 0 ? oa - ob + 3 : oa - ob;
+                r.co[i] = o;
+            }
+            for (int i = 0; i < 12; i++)
+            {
+                r.ep[i] = a.ep[b.ep[i]];
+                r.eo[i] = (a.eo[b.ep[i]] + b.eo[i]) % 2;
+            }
+            return r;
+        }
+
+        struct symmetries
+        {
+            CubieCube cube[N_SYM];
+            int inverse[N_SYM];
+
+            symmetries()
+            {
+                // 120 degrees around the URF-DBL diagonal, 180 around F-B,
+                // 90 around U-D, and the mirror through the U, D, F, B centres
+                const CubieCube urf3 = { { URF, DFR, DLF, UFL, UBR, DRB, DBL, ULB }, { 1, 2, 1, 2, 2, 1, 2, 1 },
+                    { UF, FR, DF, FL, UB, BR, DB, BL, UR, DR, DL, UL }, { 1, 0, 1, 0, 1, 0, 1, 0, 1, 1, 1, 1 } };
+                const CubieCube f2 = { { DLF, DFR, DRB, DBL, UFL, URF, UBR, ULB }, { 0, 0, 0, 0, 0, 0, 0, 0 },
+                    { DL, DF, DR, DB, UL, UF, UR, UB, FL, FR, BR, BL }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } };
+                const CubieCube u4 = { { UBR, URF, UFL, ULB, DRB, DFR, DLF, DBL }, { 0, 0, 0, 0, 0, 0, 0, 0 },
+                    { UB, UR, UF, UL, DB, DR, DF, DL, BR, FR, FL, BL }, { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1 } };
+                const CubieCube lr2 = { { UFL, URF, UBR, ULB, DLF, DFR, DRB, DBL }, { 3, 3, 3, 3, 3, 3, 3, 3 },
+                    { UL, UF, UR, UB, DL, DF, DR, DB, FL, FR, BR, BL }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } };
+
+                // ordered so that the first 16 never use the diagonal turn
+                CubieCube c = CubieCube::solved();
+                int n = 0;
+                for (int a = 0; a < 3; a++)
+                {
+                    for (int b = 0; b < 2; b++)
+                    {
+                        for (int d = 0; d < 4; d++)
+                        {
+                            for (int e = 0; e < 2; e++)
+                            {
+                                cube[n++] = c;
+                                c = multiply(c, lr2);
+                            }
+                            c = multiply(c, u4);
+                        }
+                        c = multiply(c, f2);
+                    }
+                    c = multiply(c, urf3);
+                }
+                for (int i = 0; i < N_SYM; i++)
+                    for (int j = 0; j < N_SYM; j++)
+                        if (multiply(cube[i], cube[j]) == CubieCube::solved())
+                            inverse[i] = j;
+            }
+        };
+
+        inline const symmetries& all()
+        {
+            static const symmetries instance;
+            return instance;
+        }
+
+        // S * c * S^-1
+        inline CubieCube conjugate(const CubieCube& c, int s)
+        {
+            const symmetries& sym = all();
+            return multiply(multiply(sym.cube[s], c), sym.cube[sym.inverse[s]]);
+        }
+
+        // The move S * m * S^-1 turns out to be
+        inline Move conjugate(Move m, int s)
+        {
+            CubieCube c = CubieCube::solved();
+            c.move(m);
+            c = conjugate(c, s);
+            for (int k = 0; k < MOVE_COUNT; k++)
+            {
+                CubieCube d = CubieCube::solved();
+                d.move(Move(k));
+                if (d == c)
+                    return Move(k);
+            }
+            return MOVE_COUNT;
+        }
+
+        struct tables
+        {
+            // the class of every corner permutation, and the symmetry s
+            // with S * c * S^-1 the class representative
+            std::uint16_t corner_class[40320];
+            std::uint8_t corner_sym[40320];
+            std::uint16_t corner_rep[N_CORNER_CLASSES];
+            // bit s set if S * rep * S^-1 = rep
+            std::uint16_t corner_stabilizer[N_CORNER_CLASSES];
+
+            // coordinates of S * c * S^-1; the slice permutation only
+            // while the middle layer edges are in the middle layer
+            std::uint16_t twist_conj[2187][N_SYM_UD];
+            std::uint8_t slice_conj[24][N_SYM_UD];
+
+            void build()
+            {
+                const symmetries& sym = all();
+                std::memset(corner_class, 0xff, sizeof(corner_class));
+                int classes = 0;
+                CubieCube c = CubieCube::solved();
+                for (int i = 0; i < 40320; i++)
+                {
+                    if (corner_class[i] != 0xffff)
+                        continue;
+                    c.set_corners(i);
+                    corner_rep[classes] = i;
+                    corner_stabilizer[classes] = 0;
+                    for (int s = 0; s < N_SYM_UD; s++)
+                    {
+                        int j = conjugate_corners(c, sym.inverse[s]);
+                        if (j == i)
+                            corner_stabilizer[classes] |= 1 << s;
+                        if (corner_class[j] == 0xffff)
+                        {
+                            corner_class[j] = classes;
+                            corner_sym[j] = s;
+                        }
+                    }
+                    classes++;
+                }
+
+                c = CubieCube::solved();
+                for (int i = 0; i < 2187; i++)
+                {
+                    c.set_twist(i);
+                    for (int s = 0; s < N_SYM_UD; s++)
+                        twist_conj[i][s] = conjugate(c, s).get_twist();
+                }
+                c = CubieCube::solved();
+                for (int i = 0; i < 24; i++)
+                {
+                    c.set_slice_sorted(i);
+                    for (int s = 0; s < N_SYM_UD; s++)
+                        slice_conj[i][s] = conjugate(c, s).get_slice_sorted();
+                }
+            }
+
+            // A class representative fixed by some symmetries stands for
+            // several equivalent states in the other coordinate; these pick
+            // the smallest of them
+            int canonical_twist(int corner_class_index, int twist) const
+            {
+                int best = twist, stabilizer = corner_stabilizer[corner_class_index];
+                for (int s = 1; stabilizer >> s; s++)
+                    if (stabilizer >> s & 1 && twist_conj[twist][s] < best)
+                        best = twist_conj[twist][s];
+                return best;
+            }
+
+            int canonical_slice(int corner_class_index, int slice) const
+            {
+                int best = slice, stabilizer = corner_stabilizer[corner_class_index];
+                for (int s = 1; stabilizer >> s; s++)
+                    if (stabilizer >> s & 1 && slice_conj[slice][s] < best)
+                        best = slice_conj[slice][s];
+                return best;
+            }
+
+            // Layout and contents of the cached table file
+            static const std::uint32_t VERSION = 2;
+
+            // Mapped from the table cache, or built and cached, on first use;
+            // safe to call from several threads at once
+            static const tables& get()
+            {
+                static const tables* instance = table_cache::load<tables>("symmetry", VERSION, create);
+                return *instance;
+            }
+
+        private:
+            static const tables* create()
+            {
+                tables* t = new tables;
+                t->build();
+                return t;
+            }
+
+            // corner permutation of S * c * S^-1
+            static int conjugate_corners(const CubieCube& c, int s)
+            {
+                const symmetries& sym = all();
+                const CubieCube& a = sym.cube[s];
+                const CubieCube& b = sym.cube[sym.inverse[s]];
+                CubieCube r = c;
+                for (int i = 0; i < 8; i++)
+                    r.cp[i] = a.cp[c.cp[b.cp[i]]];
+                return r.get_corners();
+            }
+        };
+    }
+}
+
+#endif
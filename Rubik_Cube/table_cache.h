@@ -0,0 +1,226 @@
+#ifndef TABLE_CACHE_H
+#define TABLE_CACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <process.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// On-disk cache of the solver tables. The first process to need a table
+// builds it and writes it to <name>.tables (in $RUBIK_TABLE_DIR, or the
+// working directory), later ones map that file read-only, so the tables
+// cost a few page faults instead of a breadth-first search and every
+// process on the machine shares one copy in the page cache.
+namespace solver
+{
+    namespace table_cache
+    {
+        const char MAGIC[8] = { 'R', 'U', 'B', 'I', 'K', 'T', 'B', 'L' };
+        const std::uint32_t ENDIAN_MARK = 0x01020304;
+
+        struct header
+        {
+            char magic[8];
+            std::uint32_t byte_order;
+            std::uint32_t version;
+            std::uint64_t size;
+            std::uint64_t checksum;
+            // keeps the table itself 64-byte aligned in the mapping
+            std::uint8_t padding[32];
+        };
+
+        // FNV-1a over 64-bit words, then over the odd tail bytes
+        inline std::uint64_t checksum(const void* data, std::uint64_t size)
+        {
+            const std::uint64_t prime = 0x100000001b3ULL;
+            std::uint64_t h = 0xcbf29ce484222325ULL;
+            const unsigned char* p = static_cast<const unsigned char*>(data);
+            std::uint64_t words = size / 8;
+            for (std::uint64_t i = 0; i < words; i++)
+            {
+                std::uint64_t w;
+                std::memcpy(&w, p + i * 8, 8);
+                h = (h ^ w) * prime;
+            }
+            for (std::uint64_t i = words * 8; i < size; i++)
+                h = (h ^ p[i]) * prime;
+            return h;
+        }
+
+        // Where the table files live; set it before the first table is used
+        inline std::string& directory()
+        {
+            static std::string dir = std::getenv("RUBIK_TABLE_DIR") ? std::getenv("RUBIK_TABLE_DIR") : "";
+            return dir;
+        }
+
+        inline std::string path_of(const char* name)
+        {
+            const std::string& dir = directory();
+            return (dir.empty() ? dir : dir + "/") + name + ".tables";
+        }
+
+        // The header alone, so checking it touches one page of the file
+        inline bool current(const header* h, std::uint32_t version, std::uint64_t size)
+        {
+            return std::memcmp(h->magic, MAGIC, 8) == 0 && h->byte_order == ENDIAN_MARK && h->version == version
+                && h->size == size;
+        }
+
+        // The header and the data after it, which reads all of the data
+        inline bool valid(const header* h, std::uint32_t version, std::uint64_t size)
+        {
+            return current(h, version, size) && h->checksum == checksum(h + 1, size);
+        }
+
+        // Maps a whole file read-only and says how long it is; null if it
+        // is missing or empty. Undo with unmap_file().
+        inline const void* map_file(const std::string& path, std::uint64_t& length)
+        {
+            const void* data = 0;
+            length = 0;
+#ifdef _WIN32
+            HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+            if (file == INVALID_HANDLE_VALUE)
+                return 0;
+            LARGE_INTEGER file_size;
+            if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+            {
+                HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+                if (mapping)
+                {
+                    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                    CloseHandle(mapping);
+                }
+                if (data)
+                    length = std::uint64_t(file_size.QuadPart);
+            }
+            CloseHandle(file);
+#else
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return 0;
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                void* p = mmap(0, std::uint64_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    data = p;
+                    length = std::uint64_t(st.st_size);
+                }
+            }
+            close(fd);
+#endif
+            return data;
+        }
+
+        inline void unmap_file(const void* data, std::uint64_t length)
+        {
+#ifdef _WIN32
+            (void)length;
+            UnmapViewOfFile(data);
+#else
+            munmap(const_cast<void*>(data), length);
+#endif
+        }
+
+        // Maps a table file read-only; null if it is missing, stale or cut
+        // short. Only the header is read here: the checksum would fault in
+        // the whole table, so it is left to verify(). The mapping lives as
+        // long as the process.
+        inline const void* map(const std::string& path, std::uint32_t version, std::uint64_t size)
+        {
+            std::uint64_t length;
+            const void* data = map_file(path, length);
+            if (data && (length != sizeof(header) + size || !current(static_cast<const header*>(data), version, size)))
+            {
+                unmap_file(data, length);
+                data = 0;
+            }
+            return data ? static_cast<const header*>(data) + 1 : 0;
+        }
+
+        // Whether a table file holds this version and its checksum matches;
+        // reads the whole file, so it is for tablegen, not for every load
+        inline bool verify(const std::string& path, std::uint32_t version, std::uint64_t size)
+        {
+            std::uint64_t length;
+            const void* data = map_file(path, length);
+            if (!data)
+                return false;
+            bool ok = length == sizeof(header) + size && valid(static_cast<const header*>(data), version, size);
+            unmap_file(data, length);
+            return ok;
+        }
+
+        // Writes the table under a name of its own, then renames it into
+        // place, so a reader never sees a half-written file
+        inline bool store(const std::string& path, std::uint32_t version, const void* table, std::uint64_t size)
+        {
+            header h = {};
+            std::memcpy(h.magic, MAGIC, 8);
+            h.byte_order = ENDIAN_MARK;
+            h.version = version;
+            h.size = size;
+            h.checksum = checksum(table, size);
+#ifdef _WIN32
+            std::string temp = path + "." + std::to_string(_getpid()) + ".tmp";
+#else
+            std::string temp = path + "." + std::to_string(getpid()) + ".tmp";
+#endif
+            std::FILE* file = std::fopen(temp.c_str(), "wb");
+            if (!file)
+                return false;
+            bool ok = std::fwrite(&h, sizeof(h), 1, file) == 1 && std::fwrite(table, size, 1, file) == 1;
+            ok = std::fclose(file) == 0 && ok;
+#ifdef _WIN32
+            ok = ok && MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+            ok = ok && std::rename(temp.c_str(), path.c_str()) == 0;
+#endif
+            if (!ok)
+                std::remove(temp.c_str());
+            return ok;
+        }
+
+        // The tables T, mapped from the cache file if it holds this version,
+        // otherwise built with create() and written to it. Bump the version
+        // whenever the layout or contents of T change.
+        template <typename T>
+        const T* load(const char* name, std::uint32_t version, const T* (*create)())
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "cached tables must be plain data");
+            std::string path = path_of(name);
+            if (const void* data = map(path, version, sizeof(T)))
+                return static_cast<const T*>(data);
+            const T* built = create();
+            if (!store(path, version, built, sizeof(T)))
+                return built;
+            // share the page cache copy with other processes
+            if (const void* data = map(path, version, sizeof(T)))
+            {
+                delete built;
+                return static_cast<const T*>(data);
+            }
+            return built;
+        }
+    }
+}
+
+#endif
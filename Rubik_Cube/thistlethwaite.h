@@ -0,0 +1,475 @@
+#ifndef THISTLETHWAITE_H
+#define THISTLETHWAITE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "coordinate.h"
+#include "cubie.h"
+#include "pruning.h"
+#include "table_cache.h"
+
+// Thistlethwaite's four-phase algorithm. Each phase moves the cube into a
+// smaller subgroup using only the moves of the current one:
+//   G0 = <U, D, R, L, F, B>         -> edges oriented
+//   G1 = <U, D, R, L, F2, B2>       -> corners oriented, E-slice edges home
+//   G2 = <U, D, R2, L2, F2, B2>     -> corners in the half-turn coset, M/S edges split
+//   G3 = <U2, D2, R2, L2, F2, B2>   -> solved
+// Every phase table holds the distance to the phase goal (modulo 3), so
+// each phase is a straight walk downhill with no search at all. All tables
+// together take about half a megabyte and are built in under 100 ms.
+namespace solver
+{
+    namespace thistlethwaite
+    {
+        const int N_FLIP_BITS = 4096;
+        const int N_TWIST = 2187;
+        const int N_SLICE = 495;
+        const int N_H = 96;          // corner permutations reachable with half turns
+        const int N_COSET = 420;     // 40320 / 96
+        const int N_COMBO = 70;      // 8 choose 4
+        const int N_PHASE4 = N_H * 24 * 24 * 12;
+
+        const int phase_move_count[4] = { 18, 14, 10, 6 };
+        const Move phase_moves[4][18] = {
+            { U1, U2, U3, R1, R2, R3, F1, F2, F3, D1, D2, D3, L1, L2, L3, B1, B2, B3 },
+            { U1, U2, U3, R1, R2, R3, F2, D1, D2, D3, L1, L2, L3, B2 },
+            { U1, U2, U3, R2, F2, D1, D2, D3, L2, B2 },
+            { U2, R2, F2, D2, L2, B2 }
+        };
+
+        // Edge positions of the M slice (UF, UB, DF, DB), the S slice
+        // (UR, UL, DR, DL) and the E slice (FR, FL, BL, BR)
+        const int slice_positions[3][4] = { { UF, UB, DF, DB }, { UR, UL, DR, DL }, { FR, FL, BL, BR } };
+
+        // Lexicographic ranks; ranks 2k and 2k+1 differ only in the order of
+        // the last two entries
+        inline int rank4(const int* p) { return coordinate::rank<4>(p); }
+        inline void unrank4(int r, int* p) { coordinate::unrank<4>(r, p); }
+
+        inline int parity4(int r)
+        {
+            static const int parity[24] = { 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0 };
+            return parity[r];
+        }
+
+        inline int corner_rank(const std::uint8_t* cp) { return coordinate::rank<8>(cp); }
+
+        struct tables
+        {
+            // phase 1: orientation bits of all 12 edge positions, moved six
+            // bits at a time
+            std::uint16_t flip_bits_move[MOVE_COUNT][2][64];
+            std::uint8_t flip_prun[pruning::bytes(N_FLIP_BITS)];
+
+            // phase 2
+            std::uint16_t twist_move[N_TWIST][14];
+            std::uint16_t slice_move[N_SLICE][14];
+            std::uint8_t twist_slice_prun[pruning::bytes(N_TWIST * N_SLICE)];
+
+            // phase 3: the half-turn corner group H, one representative per
+            // coset H * p, and the U/D layer positions of the M slice edges
+            std::uint8_t h_group[N_H][8];
+            std::uint16_t h_rank[N_H];          // sorted
+            std::uint16_t coset_rep[N_COSET];   // sorted
+            std::uint16_t coset_move[N_COSET][10];
+            std::uint8_t combo_index[256];
+            std::uint8_t combo_mask[N_COMBO];
+            std::uint8_t combo_move[N_COMBO][10];
+            std::uint8_t coset_combo_prun[pruning::bytes(N_COSET * N_COMBO)];
+
+            // phase 4: corner permutation in H times the permutation inside
+            // each slice, the E slice stored at half size (its parity is
+            // fixed by the other two)
+            std::uint8_t h_move[N_H][6];
+            std::uint8_t slice_perm_move[3][24][6];
+            std::uint8_t phase4_prun[pruning::bytes(N_PHASE4)];
+
+            void build()
+            {
+                build_phase1();
+                build_phase2();
+                build_phase3();
+                build_phase4();
+            }
+
+            // Layout and contents of the cached table file
+            static const std::uint32_t VERSION = 2;
+
+            // Mapped from the table cache, or built and cached, on first use;
+            // safe to call from several threads at once
+            static const tables& get()
+            {
+                static const tables* instance = table_cache::load<tables>("thistlethwaite", VERSION, create);
+                return *instance;
+            }
+
+            int flip_bits_after(int bits, int m) const
+            {
+                return flip_bits_move[m][0][bits & 63] ^ flip_bits_move[m][1][bits >> 6];
+            }
+
+            // Canonical rank of the coset H * p: the smallest rank in it
+            int coset_of(const std::uint8_t* cp) const
+            {
+                int best = 40320;
+                for (int k = 0; k < N_H; k++)
+                {
+                    std::uint8_t q[8];
+                    for (int i = 0; i < 8; i++)
+                        q[i] = h_group[k][cp[i]];
+                    best = std::min(best, corner_rank(q));
+                }
+                return int(std::lower_bound(coset_rep, coset_rep + N_COSET, best) - coset_rep);
+            }
+
+            int h_index(const std::uint8_t* cp) const
+            {
+                return int(std::lower_bound(h_rank, h_rank + N_H, corner_rank(cp)) - h_rank);
+            }
+
+        private:
+            static const tables* create()
+            {
+                tables* t = new tables;
+                t->build();
+                return t;
+            }
+
+            void build_phase1()
+            {
+                for (int m = 0; m < MOVE_COUNT; m++)
+                {
+                    CubieCube c = CubieCube::solved();
+                    c.move(Move(m));
+                    for (int half = 0; half < 2; half++)
+                    {
+                        for (int bits = 0; bits < 64; bits++)
+                        {
+                            int result = 0;
+                            for (int i = 0; i < 12; i++)
+                            {
+                                int from = c.ep[i] - half * 6;
+                                int flipped = (from >= 0 && from < 6) ? (bits >> from & 1) ^ c.eo[i] : 0;
+                                result |= flipped << i;
+                            }
+                            flip_bits_move[m][half][bits] = result;
+                        }
+                    }
+                }
+                pruning::build(flip_prun, N_FLIP_BITS, 0, 18, [&](std::int64_t i, int k) { return flip_bits_after(int(i), k); });
+            }
+
+            void build_phase2()
+            {
+                CubieCube c = CubieCube::solved();
+                for (int i = 0; i < N_TWIST; i++)
+                {
+                    c.set_twist(i);
+                    for (int k = 0; k < 14; k++)
+                    {
+                        CubieCube d = c;
+                        d.move(phase_moves[1][k]);
+                        twist_move[i][k] = d.get_twist();
+                    }
+                }
+                c = CubieCube::solved();
+                for (int i = 0; i < N_SLICE; i++)
+                {
+                    c.set_slice_sorted(i * 24);
+                    for (int k = 0; k < 14; k++)
+                    {
+                        CubieCube d = c;
+                        d.move(phase_moves[1][k]);
+                        slice_move[i][k] = d.get_slice_sorted() / 24;
+                    }
+                }
+                pruning::build(twist_slice_prun, N_TWIST * N_SLICE, 0, 14, [&](std::int64_t i, int k)
+                {
+                    return twist_move[i / N_SLICE][k] * N_SLICE + slice_move[i % N_SLICE][k];
+                });
+            }
+
+            void build_phase3()
+            {
+                // H: closure of the identity under the corner half turns
+                std::uint8_t group[N_H][8];
+                int count = 1;
+                for (int i = 0; i < 8; i++)
+                    group[0][i] = i;
+                for (int done = 0; done < count; done++)
+                {
+                    for (int k = 0; k < 6; k++)
+                    {
+                        CubieCube c = CubieCube::solved();
+                        std::memcpy(c.cp, group[done], 8);
+                        c.move(phase_moves[3][k]);
+                        bool seen = false;
+                        for (int j = 0; j < count && !seen; j++)
+                            seen = std::memcmp(group[j], c.cp, 8) == 0;
+                        if (!seen)
+                            std::memcpy(group[count++], c.cp, 8);
+                    }
+                }
+                std::pair<int, int> order[N_H];
+                for (int k = 0; k < N_H; k++)
+                    order[k] = std::make_pair(corner_rank(group[k]), k);
+                std::sort(order, order + N_H);
+                for (int k = 0; k < N_H; k++)
+                {
+                    h_rank[k] = order[k].first;
+                    std::memcpy(h_group[k], group[order[k].second], 8);
+                }
+
+                // label every corner permutation with its coset H * p by
+                // flooding from it with half turns applied first; scanning the
+                // ranks in order makes each label's first rank its smallest
+                std::uint8_t half_turn[6][8];
+                for (int k = 0; k < 6; k++)
+                {
+                    CubieCube c = CubieCube::solved();
+                    c.move(phase_moves[3][k]);
+                    std::memcpy(half_turn[k], c.cp, 8);
+                }
+                std::vector<std::uint16_t> label(40320, 0xffff), stack;
+                int reps = 0;
+                for (int r = 0; r < 40320; r++)
+                {
+                    if (label[r] != 0xffff)
+                        continue;
+                    coset_rep[reps] = r;
+                    label[r] = reps;
+                    stack.push_back(r);
+                    while (!stack.empty())
+                    {
+                        std::uint8_t p[8], q[8];
+                        coordinate::unrank<8>(stack.back(), p);
+                        stack.pop_back();
+                        for (int k = 0; k < 6; k++)
+                        {
+                            for (int i = 0; i < 8; i++)
+                                q[i] = half_turn[k][p[i]];
+                            int j = corner_rank(q);
+                            if (label[j] == 0xffff)
+                            {
+                                label[j] = reps;
+                                stack.push_back(j);
+                            }
+                        }
+                    }
+                    reps++;
+                }
+                for (int r = 0; r < N_COSET; r++)
+                {
+                    std::uint8_t p[8];
+                    coordinate::unrank<8>(coset_rep[r], p);
+                    for (int k = 0; k < 10; k++)
+                    {
+                        CubieCube c = CubieCube::solved();
+                        c.move(phase_moves[2][k]);
+                        std::uint8_t q[8];
+                        for (int i = 0; i < 8; i++)
+                            q[i] = p[c.cp[i]];
+                        coset_move[r][k] = label[corner_rank(q)];
+                    }
+                }
+
+                // which four of the eight U/D layer positions hold M slice edges
+                int n = 0;
+                std::memset(combo_index, 0xff, sizeof(combo_index));
+                for (int mask = 0; mask < 256; mask++)
+                {
+                    int bits = 0;
+                    for (int i = 0; i < 8; i++)
+                        bits += mask >> i & 1;
+                    if (bits == 4)
+                    {
+                        combo_index[mask] = n;
+                        combo_mask[n++] = mask;
+                    }
+                }
+                for (int r = 0; r < N_COMBO; r++)
+                {
+                    for (int k = 0; k < 10; k++)
+                    {
+                        CubieCube c = CubieCube::solved();
+                        c.move(phase_moves[2][k]);
+                        int mask = 0;
+                        for (int i = 0; i < 8; i++)
+                            if (combo_mask[r] >> c.ep[i] & 1)
+                                mask |= 1 << i;
+                        combo_move[r][k] = combo_index[mask];
+                    }
+                }
+
+                pruning::build(coset_combo_prun, N_COSET * N_COMBO, combo_index[m_slice_mask()], 10, [&](std::int64_t i, int k)
+                {
+                    return coset_move[i / N_COMBO][k] * N_COMBO + combo_move[i % N_COMBO][k];
+                });
+            }
+
+            void build_phase4()
+            {
+                for (int h = 0; h < N_H; h++)
+                {
+                    for (int k = 0; k < 6; k++)
+                    {
+                        CubieCube c = CubieCube::solved();
+                        std::memcpy(c.cp, h_group[h], 8);
+                        c.move(phase_moves[3][k]);
+                        h_move[h][k] = h_index(c.cp);
+                    }
+                }
+                for (int s = 0; s < 3; s++)
+                {
+                    for (int r = 0; r < 24; r++)
+                    {
+                        for (int k = 0; k < 6; k++)
+                        {
+                            CubieCube c = CubieCube::solved();
+                            int perm[4];
+                            unrank4(r, perm);
+                            for (int i = 0; i < 4; i++)
+                                c.ep[slice_positions[s][i]] = slice_positions[s][perm[i]];
+                            c.move(phase_moves[3][k]);
+                            slice_perm_move[s][r][k] = phase4_slice_rank(c.ep, s);
+                        }
+                    }
+                }
+                pruning::build(phase4_prun, N_PHASE4, 0, 6, [&](std::int64_t i, int k)
+                {
+                    int h, m, s, e;
+                    decode_phase4(int(i), h, m, s, e);
+                    return encode_phase4(h_move[h][k], slice_perm_move[0][m][k], slice_perm_move[1][s][k], slice_perm_move[2][e][k]);
+                });
+            }
+
+        public:
+            static int m_slice_mask()
+            {
+                int mask = 0;
+                for (int i = 0; i < 4; i++)
+                    mask |= 1 << slice_positions[0][i];
+                return mask;
+            }
+
+            static int phase4_slice_rank(const std::uint8_t* ep, int s)
+            {
+                int perm[4];
+                for (int i = 0; i < 4; i++)
+                {
+                    int j = 0;
+                    while (slice_positions[s][j] != ep[slice_positions[s][i]])
+                        j++;
+                    perm[i] = j;
+                }
+                return rank4(perm);
+            }
+
+            static int encode_phase4(int h, int m, int s, int e)
+            {
+                return ((h * 24 + m) * 24 + s) * 12 + (e >> 1);
+            }
+
+            static void decode_phase4(int i, int& h, int& m, int& s, int& e)
+            {
+                int half = i % 12;
+                i /= 12;
+                s = i % 24;
+                i /= 24;
+                m = i % 24;
+                h = i / 24;
+                // every corner permutation in H is even, so the three slice
+                // parities must add up to even as well
+                e = half * 2 + (parity4(half * 2) ^ parity4(m) ^ parity4(s));
+            }
+        };
+
+        // Solves a cube in four phases; fails only if the cube is not in G0
+        inline bool solve(const CubieCube& start, MoveSequence& result)
+        {
+            const tables& t = tables::get();
+            CubieCube c = start;
+            result.clear();
+
+            // Walks downhill through one phase table to its goal: at every
+            // step take a move of this phase whose residue is one less. No
+            // phase is longer than 15 moves.
+            auto walk = [&](int phase, const std::uint8_t* table, int goal, auto index_of)
+            {
+                int last_face = -1;
+                int i = index_of(c);
+                for (int steps = 0; i != goal; steps++)
+                {
+                    if (steps == 15 || pruning::get(table, i) == pruning::EMPTY)
+                        return false;
+                    int down = (pruning::get(table, i) + 2) % 3;
+                    bool moved = false;
+                    for (int k = 0; k < phase_move_count[phase] && !moved; k++)
+                    {
+                        Move m = phase_moves[phase][k];
+                        if (move_face(m) == last_face)
+                            continue;
+                        CubieCube next = c;
+                        next.move(m);
+                        int j = index_of(next);
+                        if (pruning::get(table, j) == down)
+                        {
+                            c = next;
+                            i = j;
+                            last_face = move_face(m);
+                            moved = true;
+                            // a phase may start on the face the previous one ended with
+                            if (!result.empty() && move_face(result.back()) == last_face)
+                            {
+                                int power = (move_power(result.back()) + move_power(m)) % 4;
+                                result.pop_back();
+                                if (power != 0)
+                                    result.push_back(make_move(last_face, power));
+                            }
+                            else
+                                result.push_back(m);
+                        }
+                    }
+                    if (!moved)
+                        return false;
+                }
+                return true;
+            };
+
+            bool ok = walk(0, t.flip_prun, 0, [](const CubieCube& x)
+            {
+                int bits = 0;
+                for (int i = 0; i < 12; i++)
+                    bits |= x.eo[i] << i;
+                return bits;
+            });
+
+            ok = ok && walk(1, t.twist_slice_prun, 0, [](const CubieCube& x)
+            {
+                return x.get_twist() * N_SLICE + x.get_slice_sorted() / 24;
+            });
+
+            ok = ok && walk(2, t.coset_combo_prun, t.combo_index[tables::m_slice_mask()], [&](const CubieCube& x)
+            {
+                int mask = 0;
+                for (int i = 0; i < 8; i++)
+                    if (x.ep[i] == UF || x.ep[i] == UB || x.ep[i] == DF || x.ep[i] == DB)
+                        mask |= 1 << i;
+                return t.coset_of(x.cp) * N_COMBO + t.combo_index[mask];
+            });
+
+            ok = ok && walk(3, t.phase4_prun, 0, [&](const CubieCube& x)
+            {
+                return tables::encode_phase4(t.h_index(x.cp), tables::phase4_slice_rank(x.ep, 0),
+                    tables::phase4_slice_rank(x.ep, 1), tables::phase4_slice_rank(x.ep, 2));
+            });
+
+            return ok && c == CubieCube::solved();
+        }
+    }
+}
+
+#endif
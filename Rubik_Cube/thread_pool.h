@@ -0,0 +1,280 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace solver
+{
+    // Fixed set of worker threads with a task deque each. A worker runs the
+    // newest task of its own deque first and steals the oldest of another
+    // when its own is empty, so tasks spawned by a task stay on the thread
+    // that spawned them while idle workers still find work.
+    class thread_pool
+    {
+    public:
+        explicit thread_pool(unsigned count = std::thread::hardware_concurrency())
+        {
+            if (count == 0)
+                count = 1;
+            for (unsigned i = 0; i < count; i++)
+                queues.emplace_back(new worker_queue);
+            for (unsigned i = 0; i < count; i++)
+                workers.emplace_back([this, i] { work(int(i)); });
+        }
+
+        ~thread_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            task_ready.notify_all();
+            for (size_t i = 0; i < workers.size(); i++)
+                workers[i].join();
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        // From a worker onto its own deque, from anywhere else round robin
+        void submit(std::function<void()> task)
+        {
+            int own = worker_index();
+            size_t q = own >= 0 ? size_t(own) : next_queue++ % queues.size();
+            {
+                std::lock_guard<std::mutex> lock(queues[q]->mutex);
+                queues[q]->tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queued++;
+            }
+            task_ready.notify_one();
+        }
+
+        // Runs one queued task on the calling thread; false if there is none
+        bool run_one()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (queued == 0)
+                    return false;
+                queued--;
+            }
+            take(worker_index())();
+            return true;
+        }
+
+        // Index of the calling thread among this pool's workers, or -1
+        int worker_index() const { return current_pool() == this ? current_index() : -1; }
+
+        size_t size() const { return workers.size(); }
+
+        // Runs body(first, last) over [0, count) in chunks of grain. The
+        // caller works through chunks too and only waits for workers that
+        // picked one up, so this is safe to call from inside a pool task.
+        template <typename Body>
+        void parallel_for(std::int64_t count, std::int64_t grain, Body body)
+        {
+            struct state
+            {
+                std::atomic<std::int64_t> next{ 0 };
+                std::mutex mutex;
+                std::condition_variable idle;
+                int active = 0;
+            };
+            std::shared_ptr<state> shared = std::make_shared<state>();
+            std::function<void(std::int64_t, std::int64_t)> run = body;
+            auto work = [shared, count, grain](const std::function<void(std::int64_t, std::int64_t)>* run)
+            {
+                for (;;)
+                {
+                    std::int64_t first = shared->next.fetch_add(grain);
+                    if (first >= count)
+                        return;
+                    (*run)(first, first + grain < count ? first + grain : count);
+                }
+            };
+            for (size_t i = 0; i < workers.size() && std::int64_t(i + 1) * grain < count; i++)
+            {
+                submit([shared, work, &run, count]
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(shared->mutex);
+                        // the caller may be gone already
+                        if (shared->next.load() >= count)
+                            return;
+                        shared->active++;
+                    }
+                    work(&run);
+                    std::lock_guard<std::mutex> lock(shared->mutex);
+                    if (--shared->active == 0)
+                        shared->idle.notify_all();
+                });
+            }
+            work(&run);
+            std::unique_lock<std::mutex> lock(shared->mutex);
+            shared->idle.wait(lock, [&] { return shared->active == 0; });
+        }
+
+        // One pool for the whole process, sized to the machine unless
+        // $RUBIK_THREADS says otherwise
+        static thread_pool& shared()
+        {
+            static thread_pool pool(shared_size());
+            return pool;
+        }
+
+    private:
+        struct worker_queue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<worker_queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> next_queue{ 0 };
+        std::mutex mutex;
+        std::condition_variable task_ready;
+        // tasks in the deques that no thread has taken yet
+        size_t queued = 0;
+        bool stopping = false;
+
+        static const thread_pool*& current_pool()
+        {
+            static thread_local const thread_pool* pool = nullptr;
+            return pool;
+        }
+
+        static int& current_index()
+        {
+            static thread_local int index = -1;
+            return index;
+        }
+
+        static unsigned shared_size()
+        {
+            const char* count = std::getenv("RUBIK_THREADS");
+            if (count && std::atoi(count) > 0)
+                return unsigned(std::atoi(count));
+            return std::thread::hardware_concurrency();
+        }
+
+        // A task for a thread that has already counted one off queued: the
+        // newest of its own deque, else the oldest of the next non-empty one
+        std::function<void()> take(int own)
+        {
+            size_t first = own >= 0 ? size_t(own) : 0;
+            for (;;)
+            {
+                for (size_t k = 0; k < queues.size(); k++)
+                {
+                    worker_queue& q = *queues[(first + k) % queues.size()];
+                    std::lock_guard<std::mutex> lock(q.mutex);
+                    if (q.tasks.empty())
+                        continue;
+                    std::function<void()> task;
+                    if (own >= 0 && k == 0)
+                    {
+                        task = std::move(q.tasks.back());
+                        q.tasks.pop_back();
+                    }
+                    else
+                    {
+                        task = std::move(q.tasks.front());
+                        q.tasks.pop_front();
+                    }
+                    return task;
+                }
+                // counted but another thread has not pushed it yet
+                std::this_thread::yield();
+            }
+        }
+
+        void work(int index)
+        {
+            current_pool() = this;
+            current_index() = index;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    task_ready.wait(lock, [this] { return stopping || queued > 0; });
+                    if (queued == 0)
+                        return;
+                    queued--;
+                }
+                take(index)();
+            }
+        }
+    };
+
+    // Tasks submitted to a pool that one caller wants to wait for, without
+    // waiting on whatever else the pool is running
+    class task_group
+    {
+    public:
+        explicit task_group(thread_pool& pool) : pool(pool) {}
+
+        ~task_group() { wait(); }
+
+        void submit(std::function<void()> task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending++;
+            }
+            pool.submit([this, task]
+            {
+                task();
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0)
+                    done.notify_all();
+            });
+        }
+
+        // A worker of the pool runs queued tasks while it waits, so a group
+        // can be waited for from inside a pool task without starving it
+        void wait()
+        {
+            if (pool.worker_index() < 0)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                done.wait(lock, [this] { return pending == 0; });
+                return;
+            }
+            for (;;)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (pending == 0)
+                        return;
+                }
+                if (!pool.run_one())
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    done.wait_for(lock, std::chrono::milliseconds(1), [this] { return pending == 0; });
+                }
+            }
+        }
+
+    private:
+        thread_pool& pool;
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t pending = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,77 @@
+// Throughput of solve_batch() on random cubes over the shared thread pool,
+// sized by $RUBIK_THREADS, every solution then checked on the cube batch.
+//
+//     batch_bench [cubes] [two_phase|thistlethwaite|optimal|layer_by_layer|cfop] [corpus]
+//
+// Cubes are random walks from solved, or the first ones of a corpus written
+// by scramble_gen.
+// With $RUBIK_TT_MB set, optimal solves share a transposition table of that
+// many megabytes and its counters are printed.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../cube_batch.h"
+#include "../scramble.h"
+#include "../solver.h"
+
+int main(int argc, char** argv)
+{
+    int cubes = argc > 1 ? std::atoi(argv[1]) : 1000;
+    solver::engine method = solver::engine::two_phase;
+    if (argc > 2 && std::strcmp(argv[2], "thistlethwaite") == 0)
+        method = solver::engine::thistlethwaite;
+    else if (argc > 2 && std::strcmp(argv[2], "optimal") == 0)
+        method = solver::engine::optimal;
+    else if (argc > 2 && std::strcmp(argv[2], "layer_by_layer") == 0)
+        method = solver::engine::layer_by_layer;
+    else if (argc > 2 && std::strcmp(argv[2], "cfop") == 0)
+        method = solver::engine::cfop;
+
+    std::mt19937 rng(1);
+    std::vector<solver::CubeState> states(cubes);
+    if (argc > 3)
+    {
+        solver::scramble::corpus corpus(argv[3]);
+        if (!corpus.valid() || corpus.size() < std::uint64_t(cubes))
+        {
+            std::printf("%s is not a corpus of %d cubes\n", argv[3], cubes);
+            return 1;
+        }
+        for (int n = 0; n < cubes; n++)
+            states[n] = solver::to_cube_state(corpus.cube(n));
+    }
+    else
+    {
+        for (int n = 0; n < cubes; n++)
+        {
+            solver::CubieCube c = solver::CubieCube::solved();
+            for (int k = 0; k < (method == solver::engine::optimal ? 12 : 40); k++)
+                c.move(solver::Move(rng() % solver::MOVE_COUNT));
+            states[n] = solver::to_cube_state(c);
+        }
+    }
+    std::vector<solver::MoveSequence> solutions(cubes);
+
+    // tables are loaded by the first solve, not timed
+    solver::solve(states[0], method);
+    solver::batch_stats stats = solver::solve_batch(states, solutions, method);
+
+    size_t moves = 0;
+    for (size_t i = 0; i < solutions.size(); i++)
+        moves += solutions[i].size();
+    std::printf("%zu cubes on %zu threads: %.2f s, %.0f solves/s, %.2f moves each\n", stats.solved,
+        solver::thread_pool::shared().size(), stats.seconds, stats.solves_per_second, double(moves) / cubes);
+    std::printf("%zu solutions leave their cube unsolved\n", solver::count_unsolved(states, solutions));
+    if (method == solver::engine::optimal && solver::transposition_table::shared())
+    {
+        const solver::transposition_table& table = *solver::transposition_table::shared();
+        solver::transposition_table::counters count = table.stats();
+        std::printf("transposition table of %zu MB: %llu hits, %llu misses, %llu collisions\n", table.size_bytes() >> 20,
+            (unsigned long long)count.hits, (unsigned long long)count.misses, (unsigned long long)count.collisions);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Cube moves per second on one core of the lane-parallel cube batch: the
+// same move on every cube, which moves whole rows and uses no kernel, then
+// a move of its own on every cube for each lane kernel the processor runs.
+// Checks every kernel against the single cube moves first.
+//
+//     lane_bench [cubes] [steps]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../cube_batch.h"
+
+using namespace solver;
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    size_t cubes = argc > 1 ? std::atoi(argv[1]) : 4096;
+    int steps = argc > 2 ? std::atoi(argv[2]) : 2000;
+
+    struct
+    {
+        const char* name;
+        cube_batch::lane_kernel kernel;
+        bool supported;
+    } kernels[] = {
+        { "scalar", cube_batch::scalar_lanes, true },
+#ifdef RUBIK_X86
+        { "avx2", cube_batch::avx2_lanes, cpu_has(true) },
+        { "avx512", cube_batch::avx512_lanes, cube_batch::cpu_has_avx512bw() },
+#endif
+    };
+
+    std::mt19937 rng(1);
+    std::vector<std::vector<Move>> moves(steps, std::vector<Move>(cubes));
+    for (int s = 0; s < steps; s++)
+        for (size_t i = 0; i < cubes; i++)
+            moves[s][i] = Move(rng() % MOVE_COUNT);
+
+    // every kernel against the one cube kernel, over the first 30 steps
+    std::vector<CubeState> expected(cubes, CubeState::solved());
+    for (int s = 0; s < 30 && s < steps; s++)
+        for (size_t i = 0; i < cubes; i++)
+            apply_move(expected[i], moves[s][i]);
+
+    {
+        cube_batch batch(cubes);
+        auto start = std::chrono::steady_clock::now();
+        for (int s = 0; s < steps; s++)
+            batch.apply(moves[s][0]);
+        double same = seconds_since(start);
+        std::printf("%zu cubes\n%.1f M moves/s, the same move on every cube\n%-8s %18s\n", cubes, cubes * steps / same / 1e6,
+            "kernel", "M moves/s, own");
+    }
+    for (const auto& k : kernels)
+    {
+        if (!k.supported)
+            continue;
+        cube_batch batch(cubes);
+        for (int s = 0; s < 30 && s < steps; s++)
+            batch.apply(moves[s], k.kernel);
+        for (size_t i = 0; i < cubes; i++)
+        {
+            if (batch.get(i) != expected[i])
+            {
+                std::printf("%s: cube %zu wrong\n", k.name, i);
+                return 1;
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int s = 0; s < steps; s++)
+            batch.apply(moves[s], k.kernel);
+        double own = seconds_since(start);
+        std::printf("%-8s %18.1f\n", k.name, cubes * steps / own / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+// Nanoseconds per face turn of every facelet move kernel the processor
+// runs, one move per call and whole runs of moves per call, on random
+// moves. Checks each kernel against the cubie-level moves first.
+//
+//     move_bench [moves]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../facelet_move.h"
+
+using namespace solver;
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 1 << 24;
+
+    struct
+    {
+        const char* name;
+        move_kernels kernels;
+        bool supported;
+    } kernels[] = {
+        { "scalar", { scalar_move, scalar_moves }, true },
+#ifdef RUBIK_X86
+        { "ssse3", { ssse3_move, ssse3_moves }, cpu_has(false) },
+        { "avx2", { avx2_move, avx2_moves }, cpu_has(true) },
+#endif
+    };
+
+    std::mt19937 rng(1);
+    std::vector<Move> moves(count);
+    for (int i = 0; i < count; i++)
+        moves[i] = Move(rng() % MOVE_COUNT);
+
+    CubieCube cube = CubieCube::solved();
+    for (int i = 0; i < 1000; i++)
+        cube.move(moves[i]);
+    CubeState expected = to_cube_state(cube);
+
+    std::printf("%-8s %14s %14s\n", "kernel", "ns/move, one", "ns/move, run");
+    for (const auto& k : kernels)
+    {
+        if (!k.supported)
+            continue;
+        CubeState one = CubeState::solved(), run = CubeState::solved();
+        for (int i = 0; i < 1000; i++)
+            k.kernels.one(one, moves[i]);
+        k.kernels.many(run, moves.data(), 1000);
+        if (one != expected || run != expected)
+        {
+            std::printf("%s: wrong result\n", k.name);
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++)
+            k.kernels.one(one, moves[i]);
+        double single = seconds_since(start);
+        start = std::chrono::steady_clock::now();
+        k.kernels.many(run, moves.data(), count);
+        double runs = seconds_since(start);
+        std::printf("%-8s %14.2f %14.2f\n", k.name, single * 1e9 / count, runs * 1e9 / count);
+    }
+    return 0;
+}
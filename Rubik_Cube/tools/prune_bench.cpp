@@ -0,0 +1,93 @@
+// Packed 2-bit pruning tables against one byte per entry: random lookup
+// throughput over tables of the two-phase sizes, and search nodes per
+// second of the two-phase solver on random cubes.
+//
+//     prune_bench [cubes]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../two_phase.h"
+
+using namespace solver;
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Sums entries at random indices, each index depending on the last lookup
+// so the loads cannot all be in flight at once
+template <typename Lookup>
+static double lookups_per_second(std::int64_t size, Lookup lookup, int& sink)
+{
+    const int count = 1 << 24;
+    std::uint64_t x = 88172645463325252ULL;
+    int sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        sum += lookup(std::int64_t((x + sum) % std::uint64_t(size)));
+    }
+    sink += sum;
+    return count / seconds_since(start);
+}
+
+int main(int argc, char** argv)
+{
+    int cubes = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    auto start = std::chrono::steady_clock::now();
+    const two_phase::tables& t = two_phase::tables::get();
+    std::printf("tables ready in %.0f ms, %.1f MB (%.1f MB at a byte per entry)\n", seconds_since(start) * 1000,
+        sizeof(t) / 1e6, (sizeof(t) + 3.0 * (sizeof(t.slice_twist_prun) + sizeof(t.slice_flip_prun)
+            + sizeof(t.corners_slice_prun) + sizeof(t.ud_edges_slice_prun))) / 1e6);
+
+    struct
+    {
+        const char* name;
+        const std::uint8_t* packed;
+        std::int64_t size;
+    } prun[] = {
+        { "slice_twist", t.slice_twist_prun, std::int64_t(two_phase::N_SLICE) * two_phase::N_TWIST },
+        { "slice_flip", t.slice_flip_prun, std::int64_t(two_phase::N_SLICE) * two_phase::N_FLIP },
+        { "corners_slice", t.corners_slice_prun, std::int64_t(symmetry::N_CORNER_CLASSES) * two_phase::N_PERM_4 },
+        { "ud_edges_slice", t.ud_edges_slice_prun, std::int64_t(two_phase::N_UD_EDGES) * two_phase::N_PERM_4 },
+    };
+    int sink = 0;
+    std::printf("\n%-16s %10s %10s %14s %14s\n", "table", "entries", "packed", "byte Mlookup/s", "2-bit Mlookup/s");
+    for (const auto& table : prun)
+    {
+        std::vector<std::uint8_t> bytes(table.size);
+        for (std::int64_t i = 0; i < table.size; i++)
+            bytes[i] = std::uint8_t(pruning::get(table.packed, i));
+        double byte_rate = lookups_per_second(table.size, [&](std::int64_t i) { return int(bytes[i]); }, sink);
+        double packed_rate = lookups_per_second(table.size, [&](std::int64_t i) { return pruning::get(table.packed, i); }, sink);
+        std::printf("%-16s %10lld %10lld %14.1f %14.1f\n", table.name, (long long)table.size,
+            (long long)pruning::bytes(table.size), byte_rate / 1e6, packed_rate / 1e6);
+    }
+
+    std::mt19937 rng(1);
+    std::uint64_t nodes = 0;
+    double elapsed = 0;
+    for (int n = 0; n < cubes; n++)
+    {
+        CubieCube c = CubieCube::solved();
+        for (int k = 0; k < 40; k++)
+            c.move(Move(rng() % MOVE_COUNT));
+        two_phase::search s(c);
+        MoveSequence moves;
+        auto solve_start = std::chrono::steady_clock::now();
+        s.run(22, moves);
+        elapsed += seconds_since(solve_start);
+        nodes += s.node_count();
+    }
+    std::printf("\n%d solves: %.2f ms each, %.2f M nodes/s\n", cubes, elapsed * 1000 / cubes, nodes / elapsed / 1e6);
+    return sink == 42 ? 1 : 0;
+}
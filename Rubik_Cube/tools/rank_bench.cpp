@@ -0,0 +1,143 @@
+// Nanoseconds per rank and unrank of the coordinate module against the
+// plain O(n^2) Lehmer code, for whole corner permutations (8 of 8) and the
+// edge groups of the optimal solver (6 of 12). Checks every rank of both
+// against the plain one first.
+//
+//     rank_bench [rounds]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../coordinate.h"
+
+using namespace solver;
+
+// The Lehmer code as the solvers had it: every digit counts the smaller
+// values among the earlier entries, unranking walks the values still free
+template <int N, int K>
+static int rank_naive(const std::uint8_t* p)
+{
+    int r = 0;
+    for (int i = 0; i < K; i++)
+    {
+        int d = p[i];
+        for (int j = 0; j < i; j++)
+            if (p[j] < p[i])
+                d--;
+        r = r * (N - i) + d;
+    }
+    return r;
+}
+
+template <int N, int K>
+static void unrank_naive(int r, std::uint8_t* p)
+{
+    int d[K];
+    for (int i = K - 1; i >= 0; i--)
+    {
+        d[i] = r % (N - i);
+        r /= N - i;
+    }
+    bool used[N] = {};
+    for (int i = 0; i < K; i++)
+    {
+        int v = 0;
+        for (int left = d[i];; v++)
+            if (!used[v] && left-- == 0)
+                break;
+        used[v] = true;
+        p[i] = std::uint8_t(v);
+    }
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct kernel
+{
+    const char* name;
+    int (*rank)(const std::uint8_t*);
+    void (*unrank)(int, std::uint8_t*);
+    bool supported;
+};
+
+template <int N, int K>
+static bool bench(int rounds)
+{
+    const kernel kernels[] = {
+        { "naive", rank_naive<N, K>, unrank_naive<N, K>, true },
+        { "scalar", coordinate::rank_scalar<N, K, std::uint8_t>, coordinate::unrank_scalar<N, K, std::uint8_t>, true },
+#ifdef RUBIK_X86
+        { "bmi2", coordinate::rank_bmi2<N, K, std::uint8_t>, coordinate::unrank_bmi2<N, K, std::uint8_t>, coordinate::cpu_has_bmi2() },
+#endif
+    };
+    const int n = coordinate::count<N, K>();
+
+    std::mt19937 rng(1);
+    std::vector<int> ranks(1 << 16);
+    for (size_t i = 0; i < ranks.size(); i++)
+        ranks[i] = int(rng() % n);
+    std::vector<std::uint8_t> perms(ranks.size() * K);
+    for (size_t i = 0; i < ranks.size(); i++)
+        unrank_naive<N, K>(ranks[i], &perms[i * K]);
+
+    std::printf("%d of %d\n%-8s %12s %12s\n", K, N, "kernel", "ns/rank", "ns/unrank");
+    for (const kernel& k : kernels)
+    {
+        if (!k.supported)
+            continue;
+        for (int r = 0; r < n; r++)
+        {
+            std::uint8_t p[K], q[K];
+            unrank_naive<N, K>(r, p);
+            k.unrank(r, q);
+            for (int i = 0; i < K; i++)
+            {
+                if (p[i] != q[i] || k.rank(p) != r)
+                {
+                    std::printf("%s: rank %d wrong\n", k.name, r);
+                    return false;
+                }
+            }
+        }
+
+        // summed so the calls are not optimised away
+        volatile int sink = 0;
+        int sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++)
+            for (size_t i = 0; i < ranks.size(); i++)
+                sum += k.rank(&perms[i * K]);
+        double rank_time = seconds_since(start);
+        std::uint8_t p[K];
+        start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++)
+        {
+            for (size_t i = 0; i < ranks.size(); i++)
+            {
+                k.unrank(ranks[i], p);
+                sum += p[K - 1];
+            }
+        }
+        double unrank_time = seconds_since(start);
+        sink = sum;
+        (void)sink;
+        double calls = double(rounds) * ranks.size();
+        std::printf("%-8s %12.2f %12.2f\n", k.name, rank_time / calls * 1e9, unrank_time / calls * 1e9);
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 100;
+    if (!bench<8, 8>(rounds) || !bench<12, 6>(rounds))
+        return 1;
+    return 0;
+}
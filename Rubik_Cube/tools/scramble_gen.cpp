@@ -0,0 +1,76 @@
+// Writes a corpus of uniformly random cubes for the benchmarks to replay,
+// timing the generation over the shared thread pool, sized by
+// $RUBIK_THREADS, then maps the file back and checks every cube in it is
+// solvable and where each cubie lands comes out even.
+//
+//     scramble_gen <file> [cubes] [seed]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../scramble.h"
+
+using namespace solver;
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::printf("usage: scramble_gen <file> [cubes] [seed]\n");
+        return 1;
+    }
+    std::int64_t cubes = argc > 2 ? std::atoll(argv[2]) : 1000000;
+    std::uint64_t seed = argc > 3 ? std::strtoull(argv[3], 0, 0) : 1;
+
+    std::vector<scramble::record> records(cubes);
+    auto start = std::chrono::steady_clock::now();
+    scramble::generate(seed, records.data(), cubes);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%lld cubes on %zu threads: %.3f s, %.2f million cubes/s\n", (long long)cubes,
+        thread_pool::shared().size(), seconds, cubes / seconds / 1e6);
+    if (!scramble::write(argv[1], seed, records.data(), cubes))
+    {
+        std::printf("cannot write %s\n", argv[1]);
+        return 1;
+    }
+
+    scramble::corpus corpus(argv[1]);
+    if (!corpus.valid() || corpus.size() != std::uint64_t(cubes))
+    {
+        std::printf("%s does not read back\n", argv[1]);
+        return 1;
+    }
+    // how often every cubie sits in every position with every twist or
+    // flip; all equally often for a uniform corpus
+    std::vector<std::uint64_t> corners(8 * 8 * 3), edges(12 * 12 * 2);
+    std::uint64_t bad = 0;
+    for (std::uint64_t i = 0; i < corpus.size(); i++)
+    {
+        CubieCube c = corpus.cube(i);
+        if (std::memcmp(&corpus[i], &records[i], sizeof(scramble::record)) != 0
+            || check_cube(to_cube_state(c)) != cube_error::none)
+            bad++;
+        for (int p = 0; p < 8; p++)
+            corners[(p * 8 + c.cp[p]) * 3 + c.co[p]]++;
+        for (int p = 0; p < 12; p++)
+            edges[(p * 12 + c.ep[p]) * 2 + c.eo[p]]++;
+    }
+    std::printf("%llu cubes in %s are not the ones generated or cannot be solved\n", (unsigned long long)bad, argv[1]);
+
+    // largest deviation from the expected count, in standard deviations
+    auto spread = [](const std::vector<std::uint64_t>& counts, double expected)
+    {
+        double worst = 0;
+        for (std::uint64_t k : counts)
+            worst = std::max(worst, std::fabs(double(k) - expected) / std::sqrt(expected));
+        return worst;
+    };
+    std::printf("corner cells within %.2f sigma, edge cells within %.2f sigma\n",
+        spread(corners, cubes / 24.0), spread(edges, cubes / 24.0));
+    return bad == 0 ? 0 : 1;
+}
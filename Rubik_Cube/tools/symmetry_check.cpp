@@ -0,0 +1,87 @@
+// Checks the symmetry-reduced tables: every symmetry maps face turns to face
+// turns, and all 16 UD conjugates of a cube get the same distance from the
+// symmetry-reduced pruning tables. Exits with 1 on the first mismatch.
+//
+//     symmetry_check [cubes] [--optimal]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#include "../optimal.h"
+#include "../symmetry.h"
+#include "../two_phase.h"
+
+using namespace solver;
+
+int main(int argc, char** argv)
+{
+    int cubes = 1000;
+    bool check_optimal = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--optimal") == 0)
+            check_optimal = true;
+        else
+            cubes = std::atoi(argv[i]);
+    }
+
+    for (int s = 0; s < symmetry::N_SYM; s++)
+    {
+        for (int m = 0; m < MOVE_COUNT; m++)
+        {
+            Move c = symmetry::conjugate(Move(m), s);
+            if (c == MOVE_COUNT || move_power(c) % 2 != move_power(Move(m)) % 2)
+            {
+                std::printf("symmetry %d does not map %s to a face turn\n", s, move_name(Move(m)).c_str());
+                return 1;
+            }
+        }
+    }
+    std::printf("48 symmetries map face turns to face turns\n");
+
+    const two_phase::tables& tp = two_phase::tables::get();
+    std::mt19937 rng(7);
+    for (int n = 0; n < cubes; n++)
+    {
+        CubieCube c = CubieCube::solved();
+        for (int k = 0; k < 30; k++)
+            c.move(two_phase::phase2_moves[rng() % 10]);
+        int d = tp.corners_slice_distance(c.get_corners(), c.get_slice_sorted());
+        for (int s = 1; s < symmetry::N_SYM_UD; s++)
+        {
+            CubieCube x = symmetry::conjugate(c, s);
+            if (tp.corners_slice_distance(x.get_corners(), x.get_slice_sorted()) != d)
+            {
+                std::printf("phase 2 corners: cube %d, symmetry %d gives another distance\n", n, s);
+                return 1;
+            }
+        }
+    }
+    std::printf("%d phase 2 cubes: conjugates share corners_slice distances\n", cubes);
+
+    if (check_optimal)
+    {
+        const optimal::tables& t = optimal::tables::get();
+        const symmetry::tables& sym = symmetry::tables::get();
+        for (int n = 0; n < cubes; n++)
+        {
+            CubieCube c = CubieCube::solved();
+            for (int k = 0; k < 30; k++)
+                c.move(Move(rng() % MOVE_COUNT));
+            int d = t.corner_distance(optimal::tables::corner_index(sym, c.get_corners(), c.get_twist()));
+            for (int s = 1; s < symmetry::N_SYM_UD; s++)
+            {
+                CubieCube x = symmetry::conjugate(c, s);
+                if (t.corner_distance(optimal::tables::corner_index(sym, x.get_corners(), x.get_twist())) != d)
+                {
+                    std::printf("optimal corners: cube %d, symmetry %d gives another distance\n", n, s);
+                    return 1;
+                }
+            }
+        }
+        std::printf("%d cubes: conjugates share corner pattern database distances\n", cubes);
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+// Builds solver tables and writes them to the table cache, so they can be
+// made once on a big machine and shipped next to the program. Tables that
+// are already cached and current are left alone unless --force is given.
+// Cached tables are checksummed first (the program itself only checks the
+// header when it maps them) and rebuilt if they do not match.
+// The number of threads comes from $RUBIK_THREADS, or the machine.
+//
+//     tablegen [--dir DIR] [--force] [symmetry|two_phase|thistlethwaite|optimal|meet_in_middle|cfop|all]...
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../cfop.h"
+#include "../meet_in_middle.h"
+#include "../optimal.h"
+#include "../symmetry.h"
+#include "../thistlethwaite.h"
+#include "../two_phase.h"
+
+using namespace solver;
+
+// in dependency order
+static const char* const table_names[] = { "symmetry", "two_phase", "thistlethwaite", "optimal", "meet_in_middle", "cfop" };
+
+template <typename T>
+static bool verify(const std::string& name)
+{
+    return table_cache::verify(table_cache::path_of(name.c_str()), T::VERSION, sizeof(T));
+}
+
+// Whether the cached file for a table is missing or fails its checksum
+static bool corrupt(const std::string& name)
+{
+    if (name == "symmetry")
+        return !verify<symmetry::tables>(name);
+    else if (name == "two_phase")
+        return !verify<two_phase::tables>(name);
+    else if (name == "thistlethwaite")
+        return !verify<thistlethwaite::tables>(name);
+    else if (name == "optimal")
+        return !verify<optimal::tables>(name);
+    else if (name == "meet_in_middle")
+        return !verify<meet_in_middle::tables>(name);
+    else
+        return !verify<cfop::tables>(name);
+}
+
+static void load(const std::string& name)
+{
+    if (name == "symmetry")
+        symmetry::tables::get();
+    else if (name == "two_phase")
+        two_phase::tables::get();
+    else if (name == "thistlethwaite")
+        thistlethwaite::tables::get();
+    else if (name == "optimal")
+        optimal::tables::get();
+    else if (name == "meet_in_middle")
+        meet_in_middle::tables::get();
+    else
+        cfop::tables::get();
+}
+
+int main(int argc, char** argv)
+{
+    bool force = false;
+    std::vector<std::string> wanted;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--force") == 0)
+            force = true;
+        else if (std::strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+            table_cache::directory() = argv[++i];
+        else
+            wanted.push_back(argv[i]);
+    }
+    if (wanted.empty())
+        wanted.push_back("all");
+
+    std::vector<std::string> names;
+    for (const char* name : table_names)
+    {
+        for (const std::string& w : wanted)
+        {
+            if (w == name || w == "all")
+            {
+                names.push_back(name);
+                break;
+            }
+        }
+    }
+    for (const std::string& w : wanted)
+    {
+        bool known = w == "all";
+        for (const char* name : table_names)
+            known = known || w == name;
+        if (!known)
+        {
+            std::fprintf(stderr, "unknown table '%s'\n", w.c_str());
+            return 1;
+        }
+    }
+
+    if (!table_cache::directory().empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(table_cache::directory(), error);
+    }
+    std::printf("%zu threads\n", thread_pool::shared().size());
+    for (const std::string& name : names)
+        if (force || corrupt(name))
+            std::remove(table_cache::path_of(name.c_str()).c_str());
+    for (const std::string& name : names)
+    {
+        auto start = std::chrono::steady_clock::now();
+        load(name);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::string path = table_cache::path_of(name.c_str());
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file)
+        {
+            std::fprintf(stderr, "%s: could not write %s\n", name.c_str(), path.c_str());
+            return 1;
+        }
+        std::fseek(file, 0, SEEK_END);
+        long size = std::ftell(file);
+        std::fclose(file);
+        std::printf("%-16s %10.0f ms %12ld bytes  %s\n", name.c_str(), ms, size, path.c_str());
+    }
+    return 0;
+}
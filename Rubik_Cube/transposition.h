@@ -0,0 +1,307 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+
+#include "cubie.h"
+
+// Positions an IDA* search has already been through. A cube carries a
+// 64-bit Zobrist hash, the XOR of one random key per (position, cubie,
+// orientation), so a move only swaps the keys of the eight cubies it
+// moves. The table behind it is a fixed array of 64-byte buckets of four
+// entries that any number of search threads read and write without locks:
+// an entry is two words, the second the XOR of the hash with the first, so
+// a torn write shows up as a key that does not match.
+namespace solver
+{
+    // The four corners and four edges a move carries round: after it,
+    // position to[k] holds the cubie from from[k], twisted or flipped by
+    // the third array
+    struct cubie_turn
+    {
+        std::uint8_t corner_to[4], corner_from[4], corner_twist[4];
+        std::uint8_t edge_to[4], edge_from[4], edge_flip[4];
+    };
+
+    struct cubie_turn_tables
+    {
+        cubie_turn move[MOVE_COUNT];
+
+        constexpr cubie_turn_tables() : move()
+        {
+            for (int m = 0; m < MOVE_COUNT; m++)
+            {
+                const CubieCube& b = basic_moves[m / 3];
+                CubieCube c = b;
+                for (int power = 1; power < m % 3 + 1; power++)
+                {
+                    // c * b, as CubieCube::multiply
+                    CubieCube r{};
+                    for (int i = 0; i < 8; i++)
+                    {
+                        r.cp[i] = c.cp[b.cp[i]];
+                        r.co[i] = std::uint8_t((c.co[b.cp[i]] + b.co[i]) % 3);
+                    }
+                    for (int i = 0; i < 12; i++)
+                    {
+                        r.ep[i] = c.ep[b.ep[i]];
+                        r.eo[i] = std::uint8_t((c.eo[b.ep[i]] + b.eo[i]) % 2);
+                    }
+                    c = r;
+                }
+                int corners = 0, edges = 0;
+                for (int i = 0; i < 8; i++)
+                {
+                    if (c.cp[i] == i)
+                        continue;
+                    move[m].corner_to[corners] = std::uint8_t(i);
+                    move[m].corner_from[corners] = c.cp[i];
+                    move[m].corner_twist[corners++] = c.co[i];
+                }
+                for (int i = 0; i < 12; i++)
+                {
+                    if (c.ep[i] == i)
+                        continue;
+                    move[m].edge_to[edges] = std::uint8_t(i);
+                    move[m].edge_from[edges] = c.ep[i];
+                    move[m].edge_flip[edges++] = c.eo[i];
+                }
+            }
+        }
+    };
+
+    inline constexpr cubie_turn_tables cubie_turns{};
+
+    struct zobrist_keys
+    {
+        std::uint64_t corner[8][8][3]; // position, cubie, twist
+        std::uint64_t edge[12][12][2]; // position, cubie, flip
+        std::uint64_t last_face[7];    // the face of the move that led here, 6 at the root
+
+        // splitmix64, so the keys are the same in every build
+        constexpr zobrist_keys() : corner(), edge(), last_face()
+        {
+            std::uint64_t state = 0x5eed;
+            auto next = [&state]
+            {
+                std::uint64_t z = state += 0x9e3779b97f4a7c15ull;
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+                return z ^ (z >> 31);
+            };
+            for (int i = 0; i < 8; i++)
+                for (int c = 0; c < 8; c++)
+                    for (int o = 0; o < 3; o++)
+                        corner[i][c][o] = next();
+            for (int i = 0; i < 12; i++)
+                for (int e = 0; e < 12; e++)
+                    for (int o = 0; o < 2; o++)
+                        edge[i][e][o] = next();
+            for (int f = 0; f < 7; f++)
+                last_face[f] = next();
+        }
+    };
+
+    inline constexpr zobrist_keys zobrist{};
+
+    inline std::uint64_t zobrist_hash(const CubieCube& cube)
+    {
+        std::uint64_t hash = 0;
+        for (int i = 0; i < 8; i++)
+            hash ^= zobrist.corner[i][cube.cp[i]][cube.co[i]];
+        for (int i = 0; i < 12; i++)
+            hash ^= zobrist.edge[i][cube.ep[i]][cube.eo[i]];
+        return hash;
+    }
+
+    // A cube and its hash, moved together
+    struct hashed_cube
+    {
+        CubieCube cube;
+        std::uint64_t hash;
+
+        explicit hashed_cube(const CubieCube& cube) : cube(cube), hash(zobrist_hash(cube)) {}
+
+        void move(Move m)
+        {
+            const cubie_turn& t = cubie_turns.move[m];
+            std::uint8_t p[4], o[4];
+            for (int k = 0; k < 4; k++)
+            {
+                int from = t.corner_from[k];
+                p[k] = cube.cp[from];
+                o[k] = std::uint8_t((cube.co[from] + t.corner_twist[k]) % 3);
+                hash ^= zobrist.corner[from][p[k]][cube.co[from]];
+            }
+            for (int k = 0; k < 4; k++)
+            {
+                int to = t.corner_to[k];
+                cube.cp[to] = p[k];
+                cube.co[to] = o[k];
+                hash ^= zobrist.corner[to][p[k]][o[k]];
+            }
+            for (int k = 0; k < 4; k++)
+            {
+                int from = t.edge_from[k];
+                p[k] = cube.ep[from];
+                o[k] = std::uint8_t(cube.eo[from] ^ t.edge_flip[k]);
+                hash ^= zobrist.edge[from][p[k]][cube.eo[from]];
+            }
+            for (int k = 0; k < 4; k++)
+            {
+                int to = t.edge_to[k];
+                cube.ep[to] = p[k];
+                cube.eo[to] = o[k];
+                hash ^= zobrist.edge[to][p[k]][o[k]];
+            }
+        }
+    };
+
+    class transposition_table
+    {
+    public:
+        // What probes and stores found; a search counts into its own and
+        // adds them to the table's when it is done, so threads do not
+        // fight over shared counters on every node
+        struct counters
+        {
+            std::uint64_t hits = 0;       // probes that cut a subtree
+            std::uint64_t misses = 0;     // probes that did not
+            std::uint64_t collisions = 0; // stores that evicted another position of the same search
+
+            counters& operator+=(const counters& other)
+            {
+                hits += other.hits;
+                misses += other.misses;
+                collisions += other.collisions;
+                return *this;
+            }
+        };
+
+        // The largest power of two number of 64-byte buckets within bytes
+        explicit transposition_table(size_t bytes)
+        {
+            size_t count = 1;
+            while (count * 2 * sizeof(bucket) <= bytes)
+                count *= 2;
+            buckets.reset(new bucket[count]);
+            mask = count - 1;
+        }
+
+        size_t size_bytes() const { return (mask + 1) * sizeof(bucket); }
+
+        // A number of its own for every search, so entries of earlier or
+        // concurrent searches never answer its probes
+        std::uint32_t new_search() { return next_search.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+        // Whether search has stored the position as searched depth moves
+        // deep, or deeper, without finding anything
+        bool probe(std::uint64_t hash, std::uint32_t search, int depth, counters& count) const
+        {
+            const bucket& b = buckets[hash & mask];
+            for (const entry& e : b.entries)
+            {
+                std::uint64_t data = e.data.load(std::memory_order_relaxed);
+                if ((e.check.load(std::memory_order_relaxed) ^ data) == hash && entry_search(data) == search
+                    && entry_depth(data) >= depth)
+                {
+                    count.hits++;
+                    return true;
+                }
+            }
+            count.misses++;
+            return false;
+        }
+
+        // Records that nothing was found depth moves deep from the position.
+        // Overwrites the same position, else a position of another search,
+        // else the shallowest.
+        void store(std::uint64_t hash, std::uint32_t search, int depth, counters& count)
+        {
+            bucket& b = buckets[hash & mask];
+            entry* victim = &b.entries[0];
+            int victim_depth = 256;
+            for (entry& e : b.entries)
+            {
+                std::uint64_t data = e.data.load(std::memory_order_relaxed);
+                bool same = (e.check.load(std::memory_order_relaxed) ^ data) == hash;
+                if (same || entry_search(data) != search)
+                {
+                    victim = &e;
+                    victim_depth = same ? -1 : 0;
+                    if (same)
+                        break;
+                    continue;
+                }
+                if (entry_depth(data) < victim_depth)
+                {
+                    victim = &e;
+                    victim_depth = entry_depth(data);
+                }
+            }
+            if (victim_depth > 0)
+                count.collisions++;
+            std::uint64_t data = std::uint64_t(search) << 8 | std::uint64_t(depth);
+            victim->data.store(data, std::memory_order_relaxed);
+            victim->check.store(hash ^ data, std::memory_order_relaxed);
+        }
+
+        void add(const counters& count)
+        {
+            std::lock_guard<std::mutex> lock(counters_mutex);
+            total += count;
+        }
+
+        counters stats() const
+        {
+            std::lock_guard<std::mutex> lock(counters_mutex);
+            return total;
+        }
+
+        // One table for the whole process if $RUBIK_TT_MB gives its size in
+        // megabytes, else none. Canonical move order already keeps most
+        // transpositions out of the searches, so the table is off unless
+        // asked for.
+        static transposition_table* shared()
+        {
+            static transposition_table* table = shared_size() > 0 ? new transposition_table(shared_size()) : nullptr;
+            return table;
+        }
+
+    private:
+        struct entry
+        {
+            std::atomic<std::uint64_t> check{ 0 };
+            std::atomic<std::uint64_t> data{ 0 }; // search << 8 | depth
+        };
+
+        struct alignas(64) bucket
+        {
+            entry entries[4];
+        };
+
+        std::unique_ptr<bucket[]> buckets;
+        size_t mask;
+        std::atomic<std::uint32_t> next_search{ 0 };
+        mutable std::mutex counters_mutex;
+        counters total;
+
+        static std::uint32_t entry_search(std::uint64_t data) { return std::uint32_t(data >> 8); }
+        static int entry_depth(std::uint64_t data) { return int(data & 255); }
+
+        static size_t shared_size()
+        {
+            const char* megabytes = std::getenv("RUBIK_TT_MB");
+            if (megabytes && std::atoi(megabytes) > 0)
+                return size_t(std::atoi(megabytes)) << 20;
+            return 0;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,422 @@
+#ifndef TWO_PHASE_H
+#define TWO_PHASE_H
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "cubie.h"
+#include "deadline.h"
+#include "pruning.h"
+#include "symmetry.h"
+#include "table_cache.h"
+
+// Kociemba's two-phase algorithm. Phase 1 brings the cube into the subgroup
+// <U, D, R2, L2, F2, B2> (no twisted corners, no flipped edges, middle layer
+// edges in the middle layer), phase 2 solves it using only those moves.
+// Both phases are IDA* searches over small coordinates, driven by move
+// tables and pruning tables that are built once and shared by every search.
+namespace solver
+{
+    namespace two_phase
+    {
+        const int N_TWIST = 2187;
+        const int N_FLIP = 2048;
+        const int N_SLICE = 495;
+        const int N_SLICE_SORTED = 11880;
+        const int N_CORNERS = 40320;
+        const int N_UD_EDGES = 40320;
+        const int N_PERM_4 = 24;
+
+        // Moves allowed in phase 2
+        const Move phase2_moves[10] = { U1, U2, U3, R2, F2, D1, D2, D3, L2, B2 };
+
+        inline bool is_phase2_move(int m)
+        {
+            return move_face(Move(m)) == 0 || move_face(Move(m)) == 3 || move_power(Move(m)) == 2;
+        }
+
+        struct tables
+        {
+            std::uint16_t twist_move[N_TWIST][MOVE_COUNT];
+            std::uint16_t flip_move[N_FLIP][MOVE_COUNT];
+            std::uint16_t slice_sorted_move[N_SLICE_SORTED][MOVE_COUNT];
+            std::uint16_t corners_move[N_CORNERS][MOVE_COUNT];
+            std::uint16_t ud_edges_move[N_UD_EDGES][MOVE_COUNT];
+
+            // distances (in face turns of the phase's move set) to the phase
+            // goal modulo 3, for a pair of coordinates each; the corners
+            // only by their symmetry class
+            std::uint8_t slice_twist_prun[pruning::bytes(N_SLICE * N_TWIST)];
+            std::uint8_t slice_flip_prun[pruning::bytes(N_SLICE * N_FLIP)];
+            std::uint8_t corners_slice_prun[pruning::bytes(symmetry::N_CORNER_CLASSES * N_PERM_4)];
+            std::uint8_t ud_edges_slice_prun[pruning::bytes(N_UD_EDGES * N_PERM_4)];
+
+            void build()
+            {
+                build_move_tables();
+                build_pruning_table(slice_twist_prun, N_TWIST, twist_move, false);
+                build_pruning_table(slice_flip_prun, N_FLIP, flip_move, false);
+                const symmetry::tables& sym = symmetry::tables::get();
+                pruning::build(corners_slice_prun, symmetry::N_CORNER_CLASSES * N_PERM_4, 0, 10, [&](std::int64_t i, int k)
+                {
+                    return corners_slice_next(sym, int(i), phase2_moves[k]);
+                });
+                // the search looks up states without making them canonical
+                for (int i = 0; i < symmetry::N_CORNER_CLASSES * N_PERM_4; i++)
+                {
+                    int canonical = i / N_PERM_4 * N_PERM_4 + sym.canonical_slice(i / N_PERM_4, i % N_PERM_4);
+                    pruning::set(corners_slice_prun, i, pruning::get(corners_slice_prun, canonical));
+                }
+                build_pruning_table(ud_edges_slice_prun, N_UD_EDGES, ud_edges_move, true);
+            }
+
+            // Layout and contents of the cached table file
+            static const std::uint32_t VERSION = 3;
+
+            // Mapped from the table cache, or built and cached, on first use;
+            // safe to call from several threads at once
+            static const tables& get()
+            {
+                static const tables* instance = table_cache::load<tables>("two_phase", VERSION, create);
+                return *instance;
+            }
+
+            // Exact distances, for the start of a search
+            int slice_twist_distance(int slice, int twist) const { return phase1_distance(slice_twist_prun, N_TWIST, twist_move, slice * N_TWIST + twist); }
+            int slice_flip_distance(int slice, int flip) const { return phase1_distance(slice_flip_prun, N_FLIP, flip_move, slice * N_FLIP + flip); }
+            int corners_slice_distance(int corners, int slice) const
+            {
+                const symmetry::tables& sym = symmetry::tables::get();
+                return pruning::distance(corners_slice_prun, corners_slice_index(sym, corners, slice), 0, 10, [&](std::int64_t i, int k)
+                {
+                    return corners_slice_next(sym, int(i), phase2_moves[k]);
+                });
+            }
+            int ud_edges_slice_distance(int ud_edges, int slice) const { return phase2_distance(ud_edges_slice_prun, ud_edges_move, ud_edges * N_PERM_4 + slice); }
+
+            // Entry of the corners and slice permutation in corners_slice_prun:
+            // corner class * 24 + the slice permutation conjugated the same way
+            static int corners_slice_index(const symmetry::tables& sym, int corners, int slice)
+            {
+                return sym.corner_class[corners] * N_PERM_4 + sym.slice_conj[slice][sym.corner_sym[corners]];
+            }
+
+        private:
+            static const tables* create()
+            {
+                tables* t = new tables;
+                t->build();
+                return t;
+            }
+
+            void build_move_tables()
+            {
+                CubieCube c = CubieCube::solved();
+                for (int i = 0; i < N_TWIST; i++)
+                {
+                    c.set_twist(i);
+                    for (int f = 0; f < 6; f++)
+                    {
+                        for (int p = 0; p < 3; p++)
+                        {
+                            c.corner_multiply(basic_move(f));
+                            twist_move[i][f * 3 + p] = c.get_twist();
+                        }
+                        c.corner_multiply(basic_move(f));
+                    }
+                }
+                c = CubieCube::solved();
+                for (int i = 0; i < N_FLIP; i++)
+                {
+                    c.set_flip(i);
+                    for (int f = 0; f < 6; f++)
+                    {
+                        for (int p = 0; p < 3; p++)
+                        {
+                            c.edge_multiply(basic_move(f));
+                            flip_move[i][f * 3 + p] = c.get_flip();
+                        }
+                        c.edge_multiply(basic_move(f));
+                    }
+                }
+                c = CubieCube::solved();
+                for (int i = 0; i < N_SLICE_SORTED; i++)
+                {
+                    c.set_slice_sorted(i);
+                    for (int f = 0; f < 6; f++)
+                    {
+                        for (int p = 0; p < 3; p++)
+                        {
+                            c.edge_multiply(basic_move(f));
+                            slice_sorted_move[i][f * 3 + p] = c.get_slice_sorted();
+                        }
+                        c.edge_multiply(basic_move(f));
+                    }
+                }
+                c = CubieCube::solved();
+                for (int i = 0; i < N_CORNERS; i++)
+                {
+                    c.set_corners(i);
+                    for (int f = 0; f < 6; f++)
+                    {
+                        for (int p = 0; p < 3; p++)
+                        {
+                            c.corner_multiply(basic_move(f));
+                            corners_move[i][f * 3 + p] = c.get_corners();
+                        }
+                        c.corner_multiply(basic_move(f));
+                    }
+                }
+                // only the phase 2 moves keep the middle layer edges at home
+                c = CubieCube::solved();
+                for (int i = 0; i < N_UD_EDGES; i++)
+                {
+                    c.set_ud_edges(i);
+                    for (int m = 0; m < MOVE_COUNT; m++)
+                    {
+                        ud_edges_move[i][m] = 0;
+                        if (!is_phase2_move(m))
+                            continue;
+                        CubieCube d = c;
+                        d.move(Move(m));
+                        ud_edges_move[i][m] = d.get_ud_edges();
+                    }
+                }
+            }
+
+            // Phase 1 tables are indexed slice * n + coordinate, phase 2
+            // tables coordinate * 24 + slice permutation, so entry 0 is the
+            // goal in both
+            int phase1_next(int n, const std::uint16_t (*coord_move)[MOVE_COUNT], int i, int m) const
+            {
+                return slice_sorted_move[i / n * 24][m] / 24 * n + coord_move[i % n][m];
+            }
+
+            int phase2_next(const std::uint16_t (*coord_move)[MOVE_COUNT], int i, int m) const
+            {
+                return coord_move[i / N_PERM_4][m] * N_PERM_4 + slice_sorted_move[i % N_PERM_4][m];
+            }
+
+            // canonical entry of a successor
+            int corners_slice_next(const symmetry::tables& sym, int i, int m) const
+            {
+                int corners = corners_move[sym.corner_rep[i / N_PERM_4]][m];
+                int slice = slice_sorted_move[i % N_PERM_4][m];
+                int corner_class = sym.corner_class[corners];
+                return corner_class * N_PERM_4 + sym.canonical_slice(corner_class, sym.slice_conj[slice][sym.corner_sym[corners]]);
+            }
+
+            int phase1_distance(const std::uint8_t* table, int n, const std::uint16_t (*coord_move)[MOVE_COUNT], int i) const
+            {
+                return pruning::distance(table, i, 0, MOVE_COUNT, [&](std::int64_t j, int m) { return phase1_next(n, coord_move, int(j), m); });
+            }
+
+            int phase2_distance(const std::uint8_t* table, const std::uint16_t (*coord_move)[MOVE_COUNT], int i) const
+            {
+                return pruning::distance(table, i, 0, 10, [&](std::int64_t j, int k) { return phase2_next(coord_move, int(j), phase2_moves[k]); });
+            }
+
+            void build_pruning_table(std::uint8_t* table, int n, const std::uint16_t (*coord_move)[MOVE_COUNT], bool phase2)
+            {
+                if (phase2)
+                    pruning::build(table, N_PERM_4 * n, 0, 10, [&](std::int64_t i, int k) { return phase2_next(coord_move, int(i), phase2_moves[k]); });
+                else
+                    pruning::build(table, N_SLICE * n, 0, MOVE_COUNT, [&](std::int64_t i, int m) { return phase1_next(n, coord_move, int(i), m); });
+            }
+        };
+
+        // One two-phase search. Holds only the current move path, so any
+        // number of searches can share the tables concurrently.
+        class search
+        {
+        public:
+            search(const CubieCube& cube) : start(cube), t(tables::get()), sym(symmetry::tables::get()) {}
+
+            // Looks for a solution of at most max_length face turns
+            bool run(int max_length, MoveSequence& result)
+            {
+                anytime = false;
+                stop = nullptr;
+                return iterate(max_length, result);
+            }
+
+            // Keeps looking for shorter solutions, each found one lowering
+            // the bound for the rest of the search, until none is left or the
+            // deadline expires. result is the shortest found by then.
+            bool improve(int max_length, const deadline& limit, MoveSequence& result)
+            {
+                anytime = true;
+                stop = &limit;
+                return iterate(max_length, result);
+            }
+
+            // Search nodes visited so far, over every run
+            std::uint64_t node_count() const { return nodes; }
+
+        private:
+            CubieCube start;
+            const tables& t;
+            const symmetry::tables& sym;
+            int max_length = 0;
+            int length = 0;
+            Move path[64];
+            std::uint64_t nodes = 0;
+            bool anytime = false;
+            const deadline* stop = nullptr;
+            bool stopped = false;
+            bool found = false;
+            MoveSequence best;
+
+            bool iterate(int max_length, MoveSequence& result)
+            {
+                this->max_length = max_length;
+                stopped = found = false;
+                int twist = start.get_twist();
+                int flip = start.get_flip();
+                int slice = start.get_slice_sorted() / 24;
+                int twist_distance = t.slice_twist_distance(slice, twist);
+                int flip_distance = t.slice_flip_distance(slice, flip);
+                // the bound shrinks as shorter solutions turn up
+                for (int depth = 0; depth <= this->max_length; depth++)
+                {
+                    if (phase1(twist, flip, slice, twist_distance, flip_distance, depth, 0))
+                    {
+                        if (!stopped)
+                        {
+                            result.assign(path, path + length);
+                            return true;
+                        }
+                        break;
+                    }
+                }
+                if (found)
+                    result = best;
+                return found;
+            }
+
+            // Every 1024 nodes, to keep the clock out of the inner loop
+            bool out_of_time()
+            {
+                if (stop && (nodes & 1023) == 0 && stop->expired())
+                    stopped = true;
+                return stopped;
+            }
+
+            static bool skip_move(int m, int last)
+            {
+                if (last < 0)
+                    return false;
+                int face = move_face(Move(m)), last_face = move_face(Move(last));
+                // same face twice, or opposite faces in the "wrong" order
+                return face == last_face || face == last_face - 3;
+            }
+
+            // The distances are exact ones from the pruning tables
+            bool phase1(int twist, int flip, int slice, int twist_distance, int flip_distance, int depth_left, int n)
+            {
+                nodes++;
+                if (out_of_time())
+                    return true;
+                if (depth_left == 0)
+                {
+                    if (twist != 0 || flip != 0 || slice != 0)
+                        return false;
+                    // a phase 1 ending in a phase 2 move is found again, shorter, by phase 2
+                    if (n > 0 && is_phase2_move(path[n - 1]))
+                        return false;
+                    if (!start_phase2(n))
+                        return false;
+                    if (stopped || !anytime)
+                        return true;
+                    best.assign(path, path + length);
+                    found = true;
+                    max_length = length - 1;
+                    return false;
+                }
+                if (std::max(twist_distance, flip_distance) > depth_left)
+                    return false;
+                for (int m = 0; m < MOVE_COUNT; m++)
+                {
+                    if (skip_move(m, n > 0 ? path[n - 1] : -1))
+                        continue;
+                    path[n] = Move(m);
+                    int next_twist = t.twist_move[twist][m];
+                    int next_flip = t.flip_move[flip][m];
+                    int next_slice = t.slice_sorted_move[slice * 24][m] / 24;
+                    int next_twist_distance = pruning::next_distance(twist_distance, pruning::get(t.slice_twist_prun, next_slice * N_TWIST + next_twist));
+                    int next_flip_distance = pruning::next_distance(flip_distance, pruning::get(t.slice_flip_prun, next_slice * N_FLIP + next_flip));
+                    if (phase1(next_twist, next_flip, next_slice, next_twist_distance, next_flip_distance, depth_left - 1, n + 1))
+                        return true;
+                }
+                return false;
+            }
+
+            bool start_phase2(int n)
+            {
+                CubieCube c = start;
+                for (int i = 0; i < n; i++)
+                    c.move(path[i]);
+                int corners = c.get_corners();
+                int ud_edges = c.get_ud_edges();
+                int slice = c.get_slice_sorted();
+                int corners_distance = t.corners_slice_distance(corners, slice);
+                int ud_edges_distance = t.ud_edges_slice_distance(ud_edges, slice);
+                for (int depth = std::max(corners_distance, ud_edges_distance); depth <= max_length - n; depth++)
+                {
+                    if (phase2(corners, ud_edges, slice, corners_distance, ud_edges_distance, depth, n))
+                        return true;
+                }
+                return false;
+            }
+
+            bool phase2(int corners, int ud_edges, int slice, int corners_distance, int ud_edges_distance, int depth_left, int n)
+            {
+                nodes++;
+                if (out_of_time())
+                    return true;
+                if (depth_left == 0)
+                {
+                    if (corners != 0 || ud_edges != 0 || slice != 0)
+                        return false;
+                    length = n;
+                    return true;
+                }
+                if (std::max(corners_distance, ud_edges_distance) > depth_left)
+                    return false;
+                for (int i = 0; i < 10; i++)
+                {
+                    int m = phase2_moves[i];
+                    if (skip_move(m, n > 0 ? path[n - 1] : -1))
+                        continue;
+                    path[n] = Move(m);
+                    int next_corners = t.corners_move[corners][m];
+                    int next_ud_edges = t.ud_edges_move[ud_edges][m];
+                    int next_slice = t.slice_sorted_move[slice][m];
+                    int next_corners_distance = pruning::next_distance(corners_distance, pruning::get(t.corners_slice_prun, tables::corners_slice_index(sym, next_corners, next_slice)));
+                    int next_ud_edges_distance = pruning::next_distance(ud_edges_distance, pruning::get(t.ud_edges_slice_prun, next_ud_edges * N_PERM_4 + next_slice));
+                    if (phase2(next_corners, next_ud_edges, next_slice, next_corners_distance, next_ud_edges_distance, depth_left - 1, n + 1))
+                        return true;
+                }
+                return false;
+            }
+        };
+
+        // Solves a cube in at most max_length face turns, if it can
+        inline bool solve(const CubieCube& cube, int max_length, MoveSequence& result)
+        {
+            search s(cube);
+            return s.run(max_length, result);
+        }
+
+        // The shortest solution of at most max_length face turns found
+        // before the deadline, if any
+        inline bool solve(const CubieCube& cube, int max_length, const deadline& limit, MoveSequence& result)
+        {
+            search s(cube);
+            return s.improve(max_length, limit, result);
+        }
+    }
+}
+
+#endif